@@ -0,0 +1,171 @@
+#include "directory_reader.h"
+
+#ifdef __linux__
+
+#include <cstddef>
+#include <new>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+/**
+ * @brief The record layout used by the `getdents64` system call, for which glibc doesn't
+ * necessarily provide a declaration.
+ */
+struct LinuxDirent64
+{
+    std::uint64_t d_ino;
+    std::int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+bool IsDotOrDotDot(const char* name) noexcept
+{
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+EntryType FromDirentType(unsigned char type) noexcept
+{
+    switch (type) {
+        case DT_REG:
+            return EntryType::Regular;
+        case DT_DIR:
+            return EntryType::Directory;
+        case DT_LNK:
+            return EntryType::Symlink;
+        case DT_UNKNOWN:
+            return EntryType::Unknown;
+        default:
+            return EntryType::Other;
+    }
+}
+
+EntryType FromFileMode(mode_t mode) noexcept
+{
+    if (S_ISREG(mode)) {
+        return EntryType::Regular;
+    }
+
+    if (S_ISDIR(mode)) {
+        return EntryType::Directory;
+    }
+
+    if (S_ISLNK(mode)) {
+        return EntryType::Symlink;
+    }
+
+    return EntryType::Other;
+}
+} // namespace
+
+DirectoryReader::DirectoryReader(const char* path) noexcept
+    : m_descriptor{ open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC) }
+{
+    if (m_descriptor >= 0) {
+        m_buffer.reset(new (std::nothrow) char[BufferSize]);
+    }
+}
+
+DirectoryReader::DirectoryReader(int parentDescriptor, const char* name) noexcept
+    : m_descriptor{
+          openat(parentDescriptor, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC) }
+{
+    if (m_descriptor >= 0) {
+        m_buffer.reset(new (std::nothrow) char[BufferSize]);
+    }
+}
+
+DirectoryReader::~DirectoryReader()
+{
+    if (m_descriptor >= 0) {
+        close(m_descriptor);
+    }
+}
+
+bool DirectoryReader::IsValid() const noexcept
+{
+    return m_descriptor >= 0 && m_buffer;
+}
+
+int DirectoryReader::GetDescriptor() const noexcept
+{
+    return m_descriptor;
+}
+
+int DirectoryReader::ReleaseDescriptor() noexcept
+{
+    m_buffer.reset();
+
+    const auto descriptor = m_descriptor;
+    m_descriptor = -1;
+
+    return descriptor;
+}
+
+bool DirectoryReader::ReadBatch(std::vector<DirectoryEntry>& entries)
+{
+    entries.clear();
+
+    if (!IsValid()) {
+        return false;
+    }
+
+    const auto bytesRead = syscall(SYS_getdents64, m_descriptor, m_buffer.get(), BufferSize);
+    if (bytesRead <= 0) {
+        return false;
+    }
+
+    for (std::size_t position = 0; position < static_cast<std::size_t>(bytesRead);) {
+        const auto* const record =
+            reinterpret_cast<const LinuxDirent64*>(m_buffer.get() + position);
+
+        position += record->d_reclen;
+
+        if (!IsDotOrDotDot(record->d_name)) {
+            const auto type = FromDirentType(record->d_type);
+            entries.push_back(DirectoryEntry{ record->d_name, type, 0, FileIdentity{}, 0 });
+        }
+    }
+
+    return true;
+}
+
+void DirectoryReader::ResolveMetadata(std::vector<DirectoryEntry>& entries) const noexcept
+{
+    for (auto& entry : entries) {
+        if (!entry.NeedsMetadata()) {
+            continue;
+        }
+
+        struct stat status;
+        if (fstatat(m_descriptor, entry.name.data(), &status, AT_SYMLINK_NOFOLLOW) != 0) {
+            entry.type = EntryType::Other;
+            continue;
+        }
+
+        SetMetadata(
+            entry, status.st_mode, static_cast<std::uintmax_t>(status.st_size),
+            FileIdentity{ static_cast<std::uint64_t>(status.st_dev),
+                          static_cast<std::uint64_t>(status.st_ino) },
+            static_cast<std::uint64_t>(status.st_nlink));
+    }
+}
+
+void DirectoryReader::SetMetadata(
+    DirectoryEntry& entry, unsigned int mode, std::uintmax_t size, FileIdentity identity,
+    std::uint64_t linkCount) noexcept
+{
+    entry.type = FromFileMode(static_cast<mode_t>(mode));
+    entry.size = entry.type == EntryType::Regular ? size : 0;
+    entry.identity = identity;
+    entry.linkCount = linkCount;
+}
+
+#endif // Linux
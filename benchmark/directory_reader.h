@@ -0,0 +1,139 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "file_identity_set.h"
+
+/**
+ * @brief The kinds of directory entries that the DirectoryReader distinguishes.
+ */
+enum class EntryType
+{
+    Regular,
+    Directory,
+    Symlink,
+    Other,
+
+    // The file system didn't report the type, so the entry still needs to be stat'ed:
+    Unknown
+};
+
+/**
+ * @brief A single entry, as produced by the DirectoryReader.
+ */
+struct DirectoryEntry
+{
+    /**
+     * @returns True if the entry's metadata still needs to be retrieved.
+     */
+    bool NeedsMetadata() const noexcept
+    {
+        return type == EntryType::Regular || type == EntryType::Unknown;
+    }
+
+    // Refers to the reader's internal buffer, and is only valid until the next batch is read. The
+    // underlying character array is null-terminated:
+    std::string_view name;
+
+    EntryType type;
+
+    // Only populated for regular files, once their metadata has been retrieved:
+    std::uintmax_t size;
+
+    // Likewise; these allow further hard links to the same file to be recognized:
+    FileIdentity identity;
+    std::uint64_t linkCount;
+};
+
+/**
+ * @brief Enumerates a directory with as few system calls as possible.
+ *
+ * The directory is opened once, after which its entries are read in large batches using
+ * `getdents64`. Since the kernel reports the type of most entries along with their name, only
+ * regular files (and the rare entry of unknown type) need their metadata retrieved separately,
+ * which is resolved relative to the open directory, rather than by walking the full path again.
+ * Symbolic links are never followed.
+ */
+class DirectoryReader
+{
+  public:
+    /**
+     * @brief Opens the specified directory, following a symbolic link if that's what the path
+     * refers to.
+     */
+    explicit DirectoryReader(const char* path) noexcept;
+
+    /**
+     * @brief Opens the named subdirectory of an open directory, without following a symbolic link
+     * that may have taken its place. If the parent descriptor is `AT_FDCWD`, the name can be any
+     * path, of which only the final component is protected in this way.
+     */
+    DirectoryReader(int parentDescriptor, const char* name) noexcept;
+
+    ~DirectoryReader();
+
+    DirectoryReader(const DirectoryReader&) = delete;
+    DirectoryReader& operator=(const DirectoryReader&) = delete;
+
+    /**
+     * @returns True if the directory was opened successfully.
+     */
+    bool IsValid() const noexcept;
+
+    /**
+     * @returns The file descriptor of the open directory.
+     */
+    int GetDescriptor() const noexcept;
+
+    /**
+     * @brief Hands ownership of the file descriptor to the caller, who becomes responsible for
+     * closing it. The reader can't be used afterwards.
+     *
+     * @returns The file descriptor of the open directory.
+     */
+    int ReleaseDescriptor() noexcept;
+
+    /**
+     * @brief Reads the next batch of entries, skipping over the "." and ".." entries.
+     *
+     * @param[out] entries            Replaced by the entries that were read. The metadata of
+     *                                these entries hasn't been retrieved yet.
+     *
+     * @returns True if a batch was read, or false once the end of the directory has been reached
+     * or an error occurred.
+     */
+    bool ReadBatch(std::vector<DirectoryEntry>& entries);
+
+    /**
+     * @brief Synchronously retrieves the metadata of every entry that needs it, using one
+     * `fstatat` call per entry. Entries that cannot be stat'ed are marked as EntryType::Other.
+     */
+    void ResolveMetadata(std::vector<DirectoryEntry>& entries) const noexcept;
+
+    /**
+     * @brief Updates an entry with the metadata that was retrieved for it.
+     *
+     * @param[in, out] entry          The entry to update.
+     * @param[in] mode                The file mode, as reported by `stat` or `statx`.
+     * @param[in] size                The size of the file, in bytes.
+     * @param[in] identity            The device and inode numbers of the file.
+     * @param[in] linkCount           The number of hard links to the file.
+     */
+    static void SetMetadata(
+        DirectoryEntry& entry, unsigned int mode, std::uintmax_t size, FileIdentity identity,
+        std::uint64_t linkCount) noexcept;
+
+  private:
+    static constexpr std::size_t BufferSize{ 32 * 1024 };
+
+    int m_descriptor;
+
+    std::unique_ptr<char[]> m_buffer;
+};
+
+#endif // Linux
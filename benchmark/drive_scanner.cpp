@@ -1,28 +1,34 @@
 #include "drive_scanner.h"
 
+#include "directory_reader.h"
+#include "metadata_ring.h"
 #include "scoped_handle.h"
 #include "stopwatch.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-#ifdef WIN32
-#pragma warning(push)
-#pragma warning(disable : 4996)
-#endif // Win32
-#include <boost/asio/post.hpp>
-#ifdef WIN32
-#pragma warning(pop)
-#endif // Win32
-
 #ifdef WIN32
 #include <FileApi.h>
 #include <WinIoCtl.h>
 #endif // Win32
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // Linux
+
 namespace
 {
 #ifdef WIN32
@@ -55,6 +61,7 @@ std::uintmax_t GetFileSizeUsingWinAPI(const std::filesystem::path& path)
 }
 #endif // Win32
 
+#ifndef __linux__
 /**
  * @brief Helper function to safely wrap the retrieval of a file's size.
  *
@@ -76,26 +83,84 @@ std::uintmax_t ComputeFileSize(const std::filesystem::path& path) noexcept
 #endif
     }
 }
+#endif // Linux
+
+#ifdef __linux__
+DirectoryStamp ToDirectoryStamp(const struct stat& status) noexcept
+{
+    constexpr std::int64_t nanosecondsPerSecond{ 1'000'000'000 };
+
+    return { static_cast<std::uint64_t>(status.st_dev), static_cast<std::uint64_t>(status.st_ino),
+             static_cast<std::int64_t>(status.st_mtim.tv_sec) * nanosecondsPerSecond +
+                 static_cast<std::int64_t>(status.st_mtim.tv_nsec) };
+}
+#endif // Linux
 
 /**
- * @brief Performs a post-processing step that iterates through the tree and computes the size
- * of all directories.
- *
- * @param[in, out] tree          The tree whose nodes need their directory sizes computed.
+ * @returns The combined size, and the number, of the Node's children that aren't directories.
  */
-void ComputeDirectorySizes(Tree<FileInfo>& tree)
+std::pair<std::intmax_t, std::intmax_t>
+ComputeFileTotals(const Tree<FileInfo>::Node& node) noexcept
 {
-    for (auto&& node : tree) {
-        Tree<FileInfo>::Node* parent = node.GetParent();
-        if (!parent) {
-            return;
+    std::intmax_t size{ 0 };
+    std::intmax_t count{ 0 };
+
+    for (const auto* child = node.GetFirstChild(); child; child = child->GetNextSibling()) {
+        if ((*child)->type != FileType::Directory) {
+            size += static_cast<std::intmax_t>((*child)->size);
+            ++count;
         }
+    }
+
+    return { size, count };
+}
 
-        FileInfo& parentInfo = parent->GetData();
-        if (parentInfo.type == FileType::Directory) {
-            parentInfo.size += node->size;
+/**
+ * @brief Matches a name or path against a glob pattern, in which a `*` matches any sequence of
+ * characters, and a `?` matches any single character.
+ */
+bool MatchesGlob(std::string_view pattern, std::string_view text) noexcept
+{
+    std::size_t patternIndex{ 0 };
+    std::size_t textIndex{ 0 };
+
+    // Where the most recent `*` was found, and where in the text it started matching, so that it
+    // can be made to match one more character when the rest of the pattern fails to match:
+    auto starIndex = std::string_view::npos;
+    std::size_t starMatchIndex{ 0 };
+
+    while (textIndex < text.size()) {
+        if (patternIndex < pattern.size() &&
+            (pattern[patternIndex] == '?' || pattern[patternIndex] == text[textIndex])) {
+            ++patternIndex;
+            ++textIndex;
+        } else if (patternIndex < pattern.size() && pattern[patternIndex] == '*') {
+            starIndex = patternIndex++;
+            starMatchIndex = textIndex;
+        } else if (starIndex != std::string_view::npos) {
+            patternIndex = starIndex + 1;
+            textIndex = ++starMatchIndex;
+        } else {
+            return false;
         }
     }
+
+    while (patternIndex < pattern.size() && pattern[patternIndex] == '*') {
+        ++patternIndex;
+    }
+
+    return patternIndex == pattern.size();
+}
+
+/**
+ * @returns The device that the root of the tree resides on, or zero if it can't be determined.
+ */
+std::uint64_t ReadRootDevice(const Tree<FileInfo>::Node& root)
+{
+    std::string path;
+    DriveScanner::BuildPath(root, path);
+
+    return DriveScanner::ReadDirectoryStamp(path).value_or(DirectoryStamp{}).device;
 }
 
 /**
@@ -109,11 +174,8 @@ std::shared_ptr<Tree<FileInfo>> CreateTreeAndRootNode(const std::filesystem::pat
         return nullptr;
     }
 
-    static const std::string blankExtension = "";
-    FileInfo fileInfo{ path.string(), blankExtension, DriveScanner::UndefinedSize,
-                       FileType::Directory };
-
-    return std::make_shared<Tree<FileInfo>>(Tree<FileInfo>(std::move(fileInfo)));
+    return std::make_shared<Tree<FileInfo>>(
+        Tree<FileInfo>(MakeDirectoryInfo(path.string(), DriveScanner::UndefinedSize)));
 }
 
 #ifdef WIN32
@@ -183,43 +245,339 @@ bool IsReparsePoint(const std::filesystem::path& path) noexcept
 }
 #endif // Win32
 
+#ifndef __linux__
 bool IsScannable(const std::filesystem::path& path) noexcept
 {
 #ifdef WIN32
     return !IsReparsePoint(path);
-#elif defined(__linux__)
+#else // Win32
     return !std::filesystem::is_symlink(path);
-#endif // Linux
+#endif
 }
+#endif // Linux
 } // namespace
 
-DriveScanner::DriveScanner(const std::filesystem::path& path)
-    : m_fileTree{ CreateTreeAndRootNode(path) }, m_rootPath{ path }
+DriveScanner::DriveScanner(const std::filesystem::path& path, ScanOptions options)
+    : m_fileTree{ CreateTreeAndRootNode(path) },
+      m_options{ std::move(options) },
+      m_scheduler{ m_options.threadCount }
+{
+    PrepareExclusions();
+}
+
+DriveScanner::DriveScanner(std::shared_ptr<Tree<FileInfo>> tree, ScanOptions options)
+    : m_fileTree{ std::move(tree) },
+      m_options{ std::move(options) },
+      m_scheduler{ m_options.threadCount }
+{
+    PrepareExclusions();
+}
+
+void DriveScanner::BuildPath(const Tree<FileInfo>::Node& node, std::string& path)
+{
+    const auto* const parent = node.GetParent();
+    if (!parent) {
+        path = node->name;
+        return;
+    }
+
+    BuildPath(*parent, path);
+
+    constexpr auto separator = static_cast<char>(std::filesystem::path::preferred_separator);
+    if (path.empty() || path.back() != separator) {
+        path += separator;
+    }
+
+    path += node->name;
+
+    if (node->extensionId != ExtensionDictionary::NoExtension) {
+        path += node->GetExtension();
+    }
+}
+
+std::optional<DirectoryStamp> DriveScanner::ReadDirectoryStamp(const std::string& path) noexcept
+{
+#ifdef __linux__
+    struct stat status;
+    if (lstat(path.c_str(), &status) != 0 || !S_ISDIR(status.st_mode)) {
+        return std::nullopt;
+    }
+
+    return ToDirectoryStamp(status);
+#else // Linux
+    std::error_code errorCode;
+    const auto modificationTime = std::filesystem::last_write_time(path, errorCode);
+    if (errorCode) {
+        return std::nullopt;
+    }
+
+    return DirectoryStamp{ 0, 0,
+                           static_cast<std::int64_t>(modificationTime.time_since_epoch().count()) };
+#endif
+}
+
+#ifdef __linux__
+std::optional<DirectoryStamp> DriveScanner::ReadDirectoryStamp(int descriptor) noexcept
 {
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || !S_ISDIR(status.st_mode)) {
+        return std::nullopt;
+    }
+
+    return ToDirectoryStamp(status);
 }
+#endif // Linux
 
-void DriveScanner::ProcessFile(
-    const std::filesystem::path& path, Tree<FileInfo>::Node& node) noexcept
+void DriveScanner::AppendFile(
+    std::string fileName, std::uintmax_t fileSize, Tree<FileInfo>::Node& node,
+    PendingDirectory* pending) noexcept
 {
-    m_progress.filesScanned.fetch_add(1);
+    m_progress.RecordFile(fileSize);
 
-    const auto fileSize = ComputeFileSize(path);
-    if (fileSize == 0u) {
+    if (fileSize == 0u || fileSize < m_options.minimumFileSize) {
         return;
     }
 
-    m_progress.bytesProcessed.fetch_add(fileSize);
+    // Only the task that owns the directory ever appends to its Node, so the lock that the caller
+    // holds only ever keeps readers out:
+    node.AppendChild(MakeRegularFileInfo(std::move(fileName), fileSize));
 
-    FileInfo fileInfo{ path.filename().stem().string(), path.filename().extension().string(),
-                       fileSize, FileType::Regular };
+    if (pending) {
+        // The reference that the owning task holds orders these before the totals are read:
+        pending->size.fetch_add(fileSize, std::memory_order_relaxed);
+        pending->fileCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void DriveScanner::AppendDirectory(
+    std::string directoryName, Tree<FileInfo>::Node& node, PendingDirectory* pending,
+    PreviousDirectories* previous) noexcept
+{
+    m_progress.RecordDirectory();
+
+    if (previous) {
+        const auto itr = previous->find(directoryName);
+        if (itr != std::end(*previous)) {
+            // Moving the Node to the end keeps the children in the order they were enumerated in:
+            auto* const directory = node.AppendChild(*itr->second);
+            previous->erase(itr);
 
-    const std::lock_guard<decltype(m_mutex)> lock{ m_mutex };
-    node.AppendChild(std::move(fileInfo));
+            m_scheduler.Post([this, directory]() noexcept { RescanDirectory(*directory); });
+            return;
+        }
+    }
+
+    auto* const lastChild =
+        node.AppendChild(MakeDirectoryInfo(std::move(directoryName), DriveScanner::UndefinedSize));
+
+    // Directories beyond the maximum depth are kept, but never enumerated:
+    if (!IsWithinMaximumDepth(*lastChild)) {
+        return;
+    }
+
+    // The caller holds the lock that guards the data of the new Node:
+    (*lastChild)->EditDirectoryDetails().isBeingScanned = true;
+
+    if (pending) {
+        pending->referenceCount.fetch_add(1);
+
+#ifdef __linux__
+        if (pending->descriptor >= 0) {
+            pending->descriptorReferenceCount.fetch_add(1, std::memory_order_relaxed);
+        }
+#endif // Linux
+    } else {
+        // A new directory in a rescanned tree has no parent to fold its totals into, so they're
+        // added to its ancestors once the rescan completes:
+        const std::lock_guard<decltype(m_changesMutex)> lock{ m_changesMutex };
+        m_newDirectories.emplace_back(lastChild);
+    }
+
+    // The new task becomes the sole owner of the subdirectory's Node. Since a Node's child list
+    // and its sibling links are distinct fields, the owner can append to it while this task keeps
+    // appending siblings after it. Capturing nothing but two pointers keeps the task small enough
+    // to be stored without a separate allocation:
+    auto* const directory = new PendingDirectory{ *lastChild, pending };
+    m_scheduler.Post([this, directory]() noexcept { ProcessDirectory(*directory); });
+}
+
+void DriveScanner::ProcessDirectory(PendingDirectory& directory) noexcept
+{
+    EnumerateDirectory(directory.node, &directory, nullptr);
+    ReleaseDirectory(directory);
 }
 
+void DriveScanner::ReleaseDirectory(PendingDirectory& directory) noexcept
+{
+    auto* current = &directory;
+
+    // Dropping a reference publishes the contributions that were made while holding it, so the
+    // last task to drop one is guaranteed to see the complete totals:
+    while (current && current->referenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        const auto size = current->size.load(std::memory_order_relaxed);
+        const auto fileCount = current->fileCount.load(std::memory_order_relaxed);
+
+        {
+            const std::unique_lock<std::shared_mutex> lock{ GetDataLock(current->node) };
+            auto& details = current->node->EditDirectoryDetails();
+            current->node->size = size;
+            details.fileCount = fileCount;
+            details.isBeingScanned = false;
+        }
+
+        auto* const parent = current->parent;
+        if (parent) {
+            parent->size.fetch_add(size, std::memory_order_relaxed);
+            parent->fileCount.fetch_add(fileCount, std::memory_order_relaxed);
+        }
+
+        delete current;
+        current = parent;
+    }
+}
+
+#ifdef __linux__
+void DriveScanner::ReleaseDescriptor(PendingDirectory& directory) noexcept
+{
+    if (directory.descriptorReferenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+        directory.descriptor >= 0) {
+        close(directory.descriptor);
+        m_retainedDescriptorCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void DriveScanner::EnumerateDirectory(
+    Tree<FileInfo>::Node& node, PendingDirectory* pending, PreviousDirectories* previous) noexcept
+{
+    auto* const parent = pending ? pending->parent : nullptr;
+    const auto hasOpenParent = parent && parent->descriptor >= 0;
+
+    // The path is only needed to open a directory whose parent isn't open, and to match path
+    // exclusions; the entries themselves are resolved relative to the directory:
+    thread_local std::string path;
+    if (!hasOpenParent || !m_pathExclusions.empty()) {
+        BuildPath(node, path);
+    }
+
+    // Only the root may be reached through a symbolic link. Any other directory was found to be a
+    // directory by its parent, and shouldn't be followed if it has since been replaced by a link:
+    DirectoryReader reader = !node.GetParent() ? DirectoryReader{ path.c_str() }
+                             : hasOpenParent
+                                 ? DirectoryReader{ parent->descriptor, node->name.c_str() }
+                                 : DirectoryReader{ AT_FDCWD, path.c_str() };
+
+    if (hasOpenParent) {
+        ReleaseDescriptor(*parent);
+    }
+
+    if (!reader.IsValid()) {
+        return;
+    }
+
+    // The stamp is taken before reading any entries, so that concurrent changes to the directory
+    // will be picked up by the next rescan:
+    struct stat status;
+    if (fstat(reader.GetDescriptor(), &status) == 0) {
+        const std::unique_lock<std::shared_mutex> lock{ GetDataLock(node) };
+        node->EditDirectoryDetails().stamp = ToDirectoryStamp(status);
+    }
+
+    // Mount points are kept, but not enumerated:
+    const auto& stamp = node->GetDirectoryDetails().stamp;
+    if (m_options.stayOnFileSystem && stamp.device != m_rootDevice) {
+        return;
+    }
+
+    // Whichever path to a directory is enumerated first claims it, so that bind mounts don't
+    // cause the same directory to be scanned several times over:
+    if (m_options.skipRepeatedDirectories && stamp.IsKnown() &&
+        !m_visitedDirectories.Insert({ stamp.device, stamp.inode })) {
+        return;
+    }
+
+#ifdef HAS_IO_URING
+    auto* const ring = m_options.useIoUring ? MetadataRing::GetForCurrentThread() : nullptr;
+#endif // io_uring
+
+    // The directory is kept open until its subdirectories have been opened relative to it, unless
+    // too many directories are open already:
+    if (pending) {
+        if (m_retainedDescriptorCount.fetch_add(1, std::memory_order_relaxed) <
+            MaximumRetainedDescriptors) {
+            pending->descriptor = reader.GetDescriptor();
+        } else {
+            m_retainedDescriptorCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Reused across calls on the same thread, so that enumerating a directory doesn't allocate:
+    thread_local std::vector<DirectoryEntry> entries;
+
+    for (auto readStart = std::chrono::steady_clock::now(); reader.ReadBatch(entries);
+         readStart = std::chrono::steady_clock::now()) {
+        const auto metadataStart = std::chrono::steady_clock::now();
+        m_progress.RecordReaddirLatency(metadataStart - readStart);
+
+        // Excluded entries are dropped before their metadata is retrieved:
+        entries.erase(
+            std::remove_if(
+                std::begin(entries), std::end(entries),
+                [&](const DirectoryEntry& entry) { return IsExcluded(path, entry.name); }),
+            std::end(entries));
+
+        const auto metadataCount = std::count_if(
+            std::begin(entries), std::end(entries),
+            [](const DirectoryEntry& entry) { return entry.NeedsMetadata(); });
+
+#ifdef HAS_IO_URING
+        if (!ring || !ring->ResolveMetadata(reader.GetDescriptor(), entries)) {
+            reader.ResolveMetadata(entries);
+        }
+#else // io_uring
+        reader.ResolveMetadata(entries);
+#endif
+
+        m_progress.RecordStatLatency(
+            std::chrono::steady_clock::now() - metadataStart,
+            static_cast<std::uint64_t>(metadataCount));
+
+        // Taking the lock once per batch, rather than once per entry, keeps its cost negligible:
+        const std::unique_lock<std::shared_mutex> lock{ GetChildrenLock(node) };
+
+        for (const auto& entry : entries) {
+            if (entry.type == EntryType::Regular) {
+                // Only the first link to a file that has several is counted towards the totals:
+                const auto isRepeatedLink = m_options.countHardLinksOnce && entry.linkCount > 1 &&
+                                            !m_visitedFiles.Insert(entry.identity);
+
+                AppendFile(
+                    std::string{ entry.name }, isRepeatedLink ? 0 : entry.size, node, pending);
+            } else if (entry.type == EntryType::Directory) {
+                // Unlike the portable implementation, this keeps empty directories, since finding
+                // out whether a directory is empty would require opening it here, as well as in
+                // its task:
+                AppendDirectory(std::string{ entry.name }, node, pending, previous);
+            }
+        }
+    }
+
+    if (pending) {
+        if (pending->descriptor >= 0) {
+            reader.ReleaseDescriptor();
+        }
+
+        ReleaseDescriptor(*pending);
+    }
+}
+#else // Linux
 void DriveScanner::ProcessPath(
-    const std::filesystem::path& path, Tree<FileInfo>::Node& node) noexcept
+    const std::filesystem::path& path, Tree<FileInfo>::Node& node, PendingDirectory* pending,
+    PreviousDirectories* previous) noexcept
 {
+    if (IsExcluded(path.parent_path().string(), path.filename().string())) {
+        return;
+    }
+
     bool isRegularFile = false;
     try {
         // In certain cases, this function can, apparently, raise exceptions, although it
@@ -230,7 +588,12 @@ void DriveScanner::ProcessPath(
     }
 
     if (isRegularFile) {
-        ProcessFile(path, node);
+        const auto metadataStart = std::chrono::steady_clock::now();
+        const auto fileSize = ComputeFileSize(path);
+        m_progress.RecordStatLatency(std::chrono::steady_clock::now() - metadataStart, 1);
+
+        const std::unique_lock<std::shared_mutex> lock{ GetChildrenLock(node) };
+        AppendFile(path.filename().string(), fileSize, node, pending);
     } else if (std::filesystem::is_directory(path) && IsScannable(path)) {
         try {
             // In some edge-cases, the Windows operating system doesn't allow anyone to access
@@ -245,32 +608,210 @@ void DriveScanner::ProcessPath(
             return;
         }
 
-        static const std::string blankExtension = "";
-        FileInfo directoryInfo{ path.filename().string(), blankExtension,
-                                DriveScanner::UndefinedSize, FileType::Directory };
+        const std::unique_lock<std::shared_mutex> lock{ GetChildrenLock(node) };
+        AppendDirectory(path.filename().string(), node, pending, previous);
+    }
+}
 
-        std::unique_lock<decltype(m_mutex)> lock{ m_mutex };
-        auto* const lastChild = node.AppendChild(std::move(directoryInfo));
-        lock.unlock();
+void DriveScanner::EnumerateDirectory(
+    Tree<FileInfo>::Node& node, PendingDirectory* pending, PreviousDirectories* previous) noexcept
+{
+    std::string path;
+    BuildPath(node, path);
 
-        m_progress.directoriesScanned.fetch_add(1);
+    const auto stamp = ReadDirectoryStamp(path).value_or(DirectoryStamp{});
 
-        AddSubDirectoriesToQueue(path, *lastChild);
+    {
+        const std::unique_lock<std::shared_mutex> lock{ GetDataLock(node) };
+        node->EditDirectoryDetails().stamp = stamp;
+    }
+
+    std::error_code errorCode;
+    auto itr = std::filesystem::directory_iterator{ path, errorCode };
+    const auto end = std::filesystem::directory_iterator{};
+
+    while (!errorCode && itr != end) {
+        ProcessPath(itr->path(), node, pending, previous);
+
+        const auto readStart = std::chrono::steady_clock::now();
+        itr.increment(errorCode);
+        m_progress.RecordReaddirLatency(std::chrono::steady_clock::now() - readStart);
     }
 }
+#endif // Linux
 
-void DriveScanner::AddSubDirectoriesToQueue(
-    const std::filesystem::path& path, Tree<FileInfo>::Node& node) noexcept
+void DriveScanner::RescanDirectory(Tree<FileInfo>::Node& node) noexcept
 {
-    auto itr = std::filesystem::directory_iterator{ path };
-    const auto end = std::filesystem::directory_iterator{};
+    if (!IsWithinMaximumDepth(node)) {
+        return;
+    }
+
+    thread_local std::string path;
+    BuildPath(node, path);
+
+    const auto stamp = ReadDirectoryStamp(path);
+    if (stamp && stamp->IsKnown() && *stamp == node->GetDirectoryDetails().stamp) {
+        // The directory still has the same entries, so only its subdirectories need a closer look:
+        for (auto* child = node.GetFirstChild(); child; child = child->GetNextSibling()) {
+            if ((*child)->type == FileType::Directory) {
+                m_progress.RecordDirectory();
+                m_scheduler.Post([this, child]() noexcept { RescanDirectory(*child); });
+            } else {
+                m_progress.RecordFile((*child)->size);
+            }
+        }
+
+        return;
+    }
+
+    // Changing a directory marks its ancestors' hashes as stale, and those are shared with other
+    // tasks. Doing so up front and under a lock means that the structural changes below, as well
+    // as those made by the tasks that this one posts, stop at this already stale Node:
+    {
+        const std::lock_guard<decltype(m_changesMutex)> lock{ m_changesMutex };
+        node.InvalidateSubtreeHash();
+    }
+
+    const auto [previousFileSize, previousFileCount] = ComputeFileTotals(node);
+
+    std::intmax_t sizeDelta = -previousFileSize;
+    std::intmax_t fileCountDelta = -previousFileCount;
+
+    // The files are simply enumerated again, while the subdirectories are set aside, so that the
+    // ones that still exist can be reused:
+    PreviousDirectories previous;
+    for (auto* child = node.GetFirstChild(); child;) {
+        auto* const nextChild = child->GetNextSibling();
+
+        if ((*child)->type == FileType::Directory) {
+            previous.emplace(child->GetData().name, child);
+        } else {
+            child->DeleteFromTree();
+        }
+
+        child = nextChild;
+    }
+
+    node->EditDirectoryDetails().stamp = DirectoryStamp{};
+    EnumerateDirectory(node, nullptr, &previous);
+
+    // Whatever wasn't claimed no longer exists:
+    for (const auto& [name, directory] : previous) {
+        sizeDelta -= static_cast<std::intmax_t>((*directory)->size);
+        fileCountDelta -=
+            static_cast<std::intmax_t>((*directory)->GetDirectoryDetails().fileCount);
+        directory->DeleteFromTree();
+    }
+
+    const auto [fileSize, fileCount] = ComputeFileTotals(node);
+    sizeDelta += fileSize;
+    fileCountDelta += fileCount;
+
+    if (sizeDelta != 0 || fileCountDelta != 0) {
+        RecordSizeChange(node, sizeDelta, fileCountDelta);
+    }
+}
 
-    while (itr != end) {
-        boost::asio::post(
-            m_threadPool, [&, path = itr->path()]() noexcept { ProcessPath(path, node); });
+void DriveScanner::RecordSizeChange(
+    Tree<FileInfo>::Node& directory, std::intmax_t sizeDelta, std::intmax_t fileCountDelta)
+{
+    const std::lock_guard<decltype(m_changesMutex)> lock{ m_changesMutex };
+    m_sizeChanges.push_back({ &directory, sizeDelta, fileCountDelta });
+}
+
+void DriveScanner::ApplySizeChanges()
+{
+    // New directories were scanned from scratch, so their totals are already final:
+    for (auto* const directory : m_newDirectories) {
+        m_sizeChanges.push_back({ directory->GetParent(),
+                                  static_cast<std::intmax_t>((*directory)->size),
+                                  static_cast<std::intmax_t>(
+                                      (*directory)->GetDirectoryDetails().fileCount) });
+    }
+
+    // Unsigned arithmetic wraps around, so adding the two's complement of a negative delta
+    // subtracts it:
+    for (const auto& change : m_sizeChanges) {
+        change.directory->InvalidateSubtreeHash();
 
-        ++itr;
+        for (auto* node = change.directory; node; node = node->GetParent()) {
+            (*node)->size += static_cast<std::uintmax_t>(change.size);
+            (*node)->EditDirectoryDetails().fileCount +=
+                static_cast<std::uintmax_t>(change.fileCount);
+        }
     }
+
+    m_newDirectories.clear();
+    m_sizeChanges.clear();
+}
+
+void DriveScanner::PrepareExclusions()
+{
+    constexpr auto separator = static_cast<char>(std::filesystem::path::preferred_separator);
+
+    for (const auto& pattern : m_options.exclusions) {
+        const auto isPathPattern = pattern.find('/') != std::string::npos ||
+                                   pattern.find(separator) != std::string::npos;
+
+        (isPathPattern ? m_pathExclusions : m_nameExclusions).emplace_back(pattern);
+    }
+}
+
+bool DriveScanner::IsExcluded(std::string_view directoryPath, std::string_view name) const noexcept
+{
+    for (const auto& pattern : m_nameExclusions) {
+        if (MatchesGlob(pattern, name)) {
+            return true;
+        }
+    }
+
+    if (m_pathExclusions.empty()) {
+        return false;
+    }
+
+    constexpr auto separator = static_cast<char>(std::filesystem::path::preferred_separator);
+
+    thread_local std::string path;
+    path.assign(directoryPath);
+
+    if (path.empty() || path.back() != separator) {
+        path += separator;
+    }
+
+    path += name;
+
+    for (const auto& pattern : m_pathExclusions) {
+        if (MatchesGlob(pattern, path)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool DriveScanner::IsWithinMaximumDepth(const Tree<FileInfo>::Node& node) const noexcept
+{
+    std::size_t depth{ 0 };
+    for (const auto* ancestor = node.GetParent(); ancestor; ancestor = ancestor->GetParent()) {
+        if (++depth > m_options.maximumDepth) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::shared_mutex& DriveScanner::GetChildrenLock(const Tree<FileInfo>::Node& node) const noexcept
+{
+    // Nodes are larger than a cache line, so discarding the lower bits loses little entropy:
+    const auto address = reinterpret_cast<std::uintptr_t>(&node);
+    return m_lockStripes[(address >> 6) % LockStripeCount].mutex;
+}
+
+std::shared_mutex& DriveScanner::GetDataLock(const Tree<FileInfo>::Node& node) const noexcept
+{
+    const auto* const parent = node.GetParent();
+    return GetChildrenLock(parent ? *parent : node);
 }
 
 std::shared_ptr<Tree<FileInfo>> DriveScanner::GetTree()
@@ -283,16 +824,49 @@ const ScanningProgress& DriveScanner::GetProgress() const
     return m_progress;
 }
 
+ScanMetrics DriveScanner::GetMetrics() const
+{
+    auto metrics = m_progress.TakeSnapshot();
+    metrics.queuedTaskCount = m_scheduler.GetQueuedTaskCount();
+    metrics.workers = m_scheduler.GetWorkerStatistics();
+
+    return metrics;
+}
+
 void DriveScanner::Start()
 {
     m_progress.Reset();
+    m_scheduler.ResetStatistics();
+    m_visitedDirectories.Clear();
+    m_visitedFiles.Clear();
+
+    auto& rootNode = *m_fileTree->GetRoot();
+    m_rootDevice = ReadRootDevice(rootNode);
+
+    {
+        const std::unique_lock<std::shared_mutex> lock{ GetDataLock(rootNode) };
+        rootNode->EditDirectoryDetails().isBeingScanned = true;
+    }
+
+    auto* const root = new PendingDirectory{ rootNode, nullptr };
+    m_scheduler.Post([this, root]() noexcept { ProcessDirectory(*root); });
+    m_scheduler.Wait();
+
+    m_progress.MarkCompleted();
+}
+
+void DriveScanner::Rescan()
+{
+    m_progress.Reset();
+    m_scheduler.ResetStatistics();
+    m_visitedDirectories.Clear();
+    m_visitedFiles.Clear();
 
-    boost::asio::post(m_threadPool, [&]() noexcept {
-        AddSubDirectoriesToQueue(m_rootPath, *m_fileTree->GetRoot());
-    });
+    m_rootDevice = ReadRootDevice(*m_fileTree->GetRoot());
 
-    m_threadPool.join();
+    m_scheduler.Post([&]() noexcept { RescanDirectory(*m_fileTree->GetRoot()); });
+    m_scheduler.Wait();
 
-    ComputeDirectorySizes(*m_fileTree);
-    m_progress.scanCompleted.store(true);
+    ApplySizeChanges();
+    m_progress.MarkCompleted();
 }
@@ -1,30 +1,69 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-#pragma warning(push)
-#pragma warning(disable : 4996)
-#include <boost/asio/thread_pool.hpp>
-#pragma warning(pop)
-
+#include "file_identity_set.h"
 #include "file_info.h"
 #include "scanning_progress.h"
+#include "task_scheduler.h"
 #include "tree.h"
 #include "win_hack.h"
 
 /**
- * @brief Wrapper around node and path.
+ * @brief Options that control how the DriveScanner retrieves file metadata, and which parts of the
+ * drive it skips.
  */
-struct NodeAndPath
+struct ScanOptions
 {
-    Tree<FileInfo>::Node& node;
-    std::filesystem::path path;
+    // Whether to retrieve the metadata of regular files through io_uring, where available, rather
+    // than through one blocking `fstatat` call per file:
+    bool useIoUring{ false };
+
+    // The number of threads to scan with. If zero, one thread is used per hardware thread:
+    unsigned int threadCount{ 0 };
+
+    // Glob patterns of entries to leave out of the tree. Excluded directories are never
+    // enumerated. A pattern that contains a path separator is matched against the full path of
+    // the entry, and otherwise against its name, including its extension. A `*` matches any
+    // sequence of characters, including separators, and a `?` matches any single character:
+    std::vector<std::string> exclusions;
+
+    // Whether to skip directories that reside on a different file system than the root. Mount
+    // points are kept as empty directories. Only supported on Linux:
+    bool stayOnFileSystem{ false };
+
+    // The depth of the deepest directories that are enumerated, where the root is at depth zero.
+    // Deeper directories are kept as empty directories:
+    std::size_t maximumDepth{ std::numeric_limits<std::size_t>::max() };
+
+    // Files smaller than this are counted as scanned, but aren't added to the tree, and don't
+    // count towards the size of their directory. Empty files are never added:
+    std::uintmax_t minimumFileSize{ 1 };
+
+    // Whether to enumerate a directory only once, even if it's reachable through several paths,
+    // such as through bind mounts. The other occurrences are kept as empty directories. Only
+    // supported on Linux:
+    bool skipRepeatedDirectories{ true };
+
+    // Whether to add a file with several hard links to the tree only once. Further links are
+    // treated like empty files. Rescans only recognize links among the directories that they
+    // enumerate again. Only supported on Linux:
+    bool countHardLinksOnce{ false };
 };
 
 /**
@@ -35,15 +74,107 @@ class DriveScanner
   public:
     static constexpr std::uintmax_t UndefinedSize{ 0 };
 
-    explicit DriveScanner(const std::filesystem::path& path);
+    explicit DriveScanner(const std::filesystem::path& path, ScanOptions options = {});
+
+    /**
+     * @brief Adopts a tree produced by an earlier scan, so that it can be brought up to date with
+     * Rescan().
+     *
+     * @param[in] tree                The tree to adopt. The name of its root needs to be the path
+     *                                that the earlier scan started from.
+     */
+    explicit DriveScanner(std::shared_ptr<Tree<FileInfo>> tree, ScanOptions options = {});
 
     /**
      * @brief Kicks off the drive scanning process.
+     *
+     * While the scan runs, other threads may read the tree through VisitNode(...) and
+     * VisitChildren(...). Directories show up as soon as they're discovered, and are flagged as
+     * being scanned until their entire subtree has been scanned, at which point their totals are
+     * final.
      */
     void Start();
 
+    /**
+     * @brief Brings the tree up to date with the drive, reusing as much of it as possible.
+     *
+     * Every directory is still visited, but only the directories whose DirectoryStamp changed
+     * since the last scan are enumerated again. Directories that are still present keep their
+     * Nodes, so that their own contents can be reused in turn. Once the scan completes, only the
+     * sizes along the ancestor chains of the changed directories are updated.
+     *
+     * @note The tree is updated in place. Since a file can be modified without the directory that
+     * contains it changing, the sizes of such files will remain outdated. Nodes are deleted along
+     * the way, so unlike with Start(), the tree can't be read until the rescan completes.
+     */
+    void Rescan();
+
+    /**
+     * @brief Rebuilds the location of a Node on disk from its name, and the names of its
+     * ancestors. The name of the root holds the path that the scan started from.
+     *
+     * @param[in] node                A Node in a tree that was produced by a DriveScanner.
+     * @param[out] path               Replaced by the location of the Node.
+     */
+    static void BuildPath(const Tree<FileInfo>::Node& node, std::string& path);
+
+    /**
+     * @brief Retrieves the DirectoryStamp of the directory at the specified location. Symbolic
+     * links aren't followed.
+     *
+     * @returns The stamp, or std::nullopt if there's no accessible directory at that location.
+     */
+    static std::optional<DirectoryStamp> ReadDirectoryStamp(const std::string& path) noexcept;
+
+#ifdef __linux__
+    /**
+     * @brief Retrieves the DirectoryStamp of an open directory.
+     *
+     * @returns The stamp, or std::nullopt if the descriptor doesn't refer to an accessible
+     * directory.
+     */
+    static std::optional<DirectoryStamp> ReadDirectoryStamp(int descriptor) noexcept;
+#endif // Linux
+
+    /**
+     * @brief Calls the visitor with the specified Node, while it's safe to read the Node's data.
+     * This may be called from any thread, even while a scan is in progress.
+     *
+     * @param[in] node                A Node in the tree.
+     * @param[in] visitor             A callable that takes a `const Tree<FileInfo>::Node&`. It
+     *                                must not call back into the scanner, and must not follow the
+     *                                links of the Node.
+     */
+    template <typename VisitorType>
+    void VisitNode(const Tree<FileInfo>::Node& node, VisitorType&& visitor) const
+    {
+        const std::shared_lock<std::shared_mutex> lock{ GetDataLock(node) };
+        visitor(node);
+    }
+
+    /**
+     * @brief Calls the visitor with every child of the specified Node, while it's safe to read the
+     * children's data. This may be called from any thread, even while a scan is in progress.
+     *
+     * To descend further, hold on to the children of interest, and visit them in turn once this
+     * returns.
+     *
+     * @param[in] node                A Node in the tree.
+     * @param[in] visitor             See VisitNode(...).
+     */
+    template <typename VisitorType>
+    void VisitChildren(const Tree<FileInfo>::Node& node, VisitorType&& visitor) const
+    {
+        const std::shared_lock<std::shared_mutex> lock{ GetChildrenLock(node) };
+        for (const auto* child = node.GetFirstChild(); child; child = child->GetNextSibling()) {
+            visitor(*child);
+        }
+    }
+
     /**
      * @returns The file tree.
+     *
+     * @note The tree can only be accessed directly once the scan has completed.
      */
     std::shared_ptr<Tree<FileInfo>> GetTree();
 
@@ -52,41 +183,238 @@ class DriveScanner
      */
     const ScanningProgress& GetProgress() const;
 
+    /**
+     * @brief Assembles a snapshot of the scan's progress, its throughput, how the worker threads
+     * have spent their time, and how long the underlying system calls took. This may be called
+     * from any thread, even while a scan is in progress.
+     */
+    ScanMetrics GetMetrics() const;
+
   private:
+    // The watcher continues where a scan left off, so it applies the same options, and claims
+    // directories and files in the same sets:
+    friend class DriveWatcher;
+
+    // The subdirectories of a directory that is being enumerated again, keyed by their names:
+    using PreviousDirectories = std::unordered_map<std::string_view, Tree<FileInfo>::Node*>;
+
+    // The totals of a directory that is still being scanned. Every task that contributes to the
+    // totals holds a reference, and whichever task drops the last one writes the totals to the
+    // directory's Node, and adds them to its parent. Since each directory has its own counter,
+    // the totals travel up the tree as subtrees complete, without any global lock:
+    struct PendingDirectory
+    {
+        Tree<FileInfo>::Node& node;
+
+        // The parent's record, or nullptr if the parent isn't being scanned from scratch:
+        PendingDirectory* parent;
+
+        // The directory's own task, plus one reference per subdirectory that's still pending:
+        std::atomic<std::uint32_t> referenceCount{ 1 };
+
+        std::atomic<std::uintmax_t> size{ 0 };
+        std::atomic<std::uintmax_t> fileCount{ 0 };
+
+#ifdef __linux__
+        // The open directory, relative to which its subdirectories are opened, or -1 if it hasn't
+        // been opened yet. It's closed once the directory has been enumerated, and each of its
+        // subdirectories has been opened; the directory's own task and every subdirectory that
+        // hasn't been opened yet each hold a reference:
+        int descriptor{ -1 };
+        std::atomic<std::uint32_t> descriptorReferenceCount{ 1 };
+#endif // Linux
+    };
+
+    // A change in the totals of a directory's contents, recorded during a rescan:
+    struct SizeChange
+    {
+        Tree<FileInfo>::Node* directory;
+        std::intmax_t size;
+        std::intmax_t fileCount;
+    };
+
     /**
-     * @brief Helper function to process a single file.
+     * @brief Appends a regular file to the tree.
      *
-     * @note This function assumes the path is valid and accessible.
+     * @param[in] fileName            The name of the file, including its extension.
+     * @param[in] fileSize            The size of the file, in bytes.
+     * @param[in] node                The Node in Tree to append the file to.
+     * @param[in, out] pending        The totals of the directory, if it's being scanned from
+     *                                scratch.
      *
-     * @param[in] path                The location on disk to scan.
-     * @param[in] fileNode            The Node in Tree to append newly discoved files to.
+     * @note The caller needs to hold the children lock of the Node exclusively.
      */
-    void ProcessFile(const std::filesystem::path& path, Tree<FileInfo>::Node& node) noexcept;
+    void AppendFile(
+        std::string fileName, std::uintmax_t fileSize, Tree<FileInfo>::Node& node,
+        PendingDirectory* pending) noexcept;
 
     /**
-     * @brief Performs a recursive depth-first exploration of the file system.
+     * @brief Appends a directory to the tree, and hands it off to a new task to be scanned.
+     *
+     * @param[in] directoryName       The name of the directory.
+     * @param[in] node                The Node in Tree to append the directory to.
+     * @param[in, out] pending        See AppendFile(...). The new directory holds a reference to
+     *                                it until its own subtree has been scanned.
+     * @param[in, out] previous       When enumerating a directory again, its former
+     *                                subdirectories. If the directory is among them, its existing
+     *                                Node is moved to the end of the child list and rescanned,
+     *                                rather than scanned from scratch.
+     *
+     * @note The caller needs to hold the children lock of the Node exclusively.
+     */
+    void AppendDirectory(
+        std::string directoryName, Tree<FileInfo>::Node& node, PendingDirectory* pending,
+        PreviousDirectories* previous) noexcept;
+
+#ifndef __linux__
+    /**
+     * @brief Processes a single directory entry, using the portable `std::filesystem` functions.
      *
      * @param[in] path                The location on disk to scan.
      * @param[in] fileNode            The Node in Tree to append newly discoved files to.
+     * @param[in, out] pending        See AppendFile(...).
+     * @param[in, out] previous       See AppendDirectory(...).
      */
-    void ProcessPath(const std::filesystem::path& path, Tree<FileInfo>::Node& node) noexcept;
+    void ProcessPath(
+        const std::filesystem::path& path, Tree<FileInfo>::Node& node, PendingDirectory* pending,
+        PreviousDirectories* previous) noexcept;
+#endif // Linux
 
     /**
-     * @brief Adds directories to thread-pool queue.
+     * @brief Processes every entry of a directory. Files are appended inline, while each
+     * subdirectory is handed off to a new task.
+     *
+     * On Linux, the directory is enumerated in batches by a DirectoryReader, and the metadata of
+     * each batch is either retrieved synchronously, or through the thread's MetadataRing.
+     * Elsewhere, the portable `std::filesystem` functions are used.
+     *
+     * On Linux, a subdirectory is opened relative to its parent, which is kept open until all of
+     * its subdirectories have been, so that the kernel doesn't need to resolve the full path again.
+     * Elsewhere, and when the parent isn't open, the location of the directory is rebuilt from the
+     * names of the Node's ancestors, so that a task only needs to capture a single pointer.
+     *
+     * @note The task that runs this function owns the directory's Node; no other task will
+     * append to it.
      *
-     * @param[in] path                Path to the directory to iterate over.
      * @param[in] Node                The Node to append the contents of the directory to.
+     * @param[in, out] pending        See AppendFile(...).
+     * @param[in, out] previous       See AppendDirectory(...).
+     */
+    void EnumerateDirectory(
+        Tree<FileInfo>::Node& node, PendingDirectory* pending,
+        PreviousDirectories* previous) noexcept;
+
+    /**
+     * @brief Scans a directory from scratch, and then drops the reference that its task holds.
+     */
+    void ProcessDirectory(PendingDirectory& directory) noexcept;
+
+    /**
+     * @brief Drops a reference to a directory's totals. If it was the last reference, the totals
+     * are final, and are folded into the parent, which may in turn complete, and so on.
      */
-    void AddSubDirectoriesToQueue(
-        const std::filesystem::path& path, Tree<FileInfo>::Node& node) noexcept;
+    void ReleaseDirectory(PendingDirectory& directory) noexcept;
+
+#ifdef __linux__
+    /**
+     * @brief Drops a reference to a directory's open descriptor, and closes it if it was the last
+     * reference.
+     */
+    void ReleaseDescriptor(PendingDirectory& directory) noexcept;
+#endif // Linux
+
+    /**
+     * @brief Rescans a directory that was part of the previous scan. If its DirectoryStamp is
+     * unchanged, its files are kept as they are, and only its subdirectories are rescanned.
+     * Otherwise, the directory is enumerated again.
+     *
+     * @param[in] node                The Node that represents the directory.
+     */
+    void RescanDirectory(Tree<FileInfo>::Node& node) noexcept;
+
+    /**
+     * @brief Records a change in the totals of a directory's contents, to be applied to the
+     * directory and its ancestors once the rescan completes.
+     */
+    void RecordSizeChange(
+        Tree<FileInfo>::Node& directory, std::intmax_t sizeDelta, std::intmax_t fileCountDelta);
+
+    /**
+     * @brief Applies the size changes that were recorded during a rescan.
+     */
+    void ApplySizeChanges();
+
+    /**
+     * @brief Splits the exclusion patterns into the ones that match names, and the ones that
+     * match paths.
+     */
+    void PrepareExclusions();
+
+    /**
+     * @returns True if the entry with the specified name, in the directory at the specified
+     * location, matches one of the exclusion patterns.
+     */
+    bool IsExcluded(std::string_view directoryPath, std::string_view name) const noexcept;
+
+    /**
+     * @returns True if the directory that the Node represents should be enumerated, given its
+     * depth.
+     */
+    bool IsWithinMaximumDepth(const Tree<FileInfo>::Node& node) const noexcept;
+
+    /**
+     * @returns The lock that guards the child list of the specified Node. Appending children
+     * requires it to be held exclusively.
+     */
+    std::shared_mutex& GetChildrenLock(const Tree<FileInfo>::Node& node) const noexcept;
+
+    /**
+     * @returns The lock that guards the data of the specified Node, which is the lock that guards
+     * the child list of its parent. That way, the data of all children can be read at once.
+     */
+    std::shared_mutex& GetDataLock(const Tree<FileInfo>::Node& node) const noexcept;
 
     ScanningProgress m_progress;
 
     std::shared_ptr<Tree<FileInfo>> m_fileTree{ nullptr };
 
-    const std::filesystem::path m_rootPath;
+    const ScanOptions m_options;
+
+    std::vector<std::string> m_nameExclusions;
+    std::vector<std::string> m_pathExclusions;
+
+    // The device that the root resides on, as used to stay on the same file system:
+    std::uint64_t m_rootDevice{ 0 };
+
+    // The directories that have been enumerated, and the files with several hard links that have
+    // been added, during the current scan:
+    FileIdentitySet m_visitedDirectories;
+    FileIdentitySet m_visitedFiles;
+
+    // Only changed directories are recorded during a rescan, so this lock is rarely contended:
+    std::mutex m_changesMutex;
+    std::vector<SizeChange> m_sizeChanges;
+    std::vector<Tree<FileInfo>::Node*> m_newDirectories;
+
+#ifdef __linux__
+    // Directories that are kept open for the sake of their subdirectories count towards the
+    // process's descriptor limit. Beyond this many, subdirectories are opened by path instead:
+    static constexpr std::size_t MaximumRetainedDescriptors{ 256 };
+
+    std::atomic<std::size_t> m_retainedDescriptorCount{ 0 };
+#endif // Linux
+
+    // Readers are kept from observing a Node while it's being modified by a fixed set of locks,
+    // rather than one lock per Node. Each lock lives on its own cache line, so that writers
+    // appending to unrelated directories don't contend through false sharing:
+    struct alignas(64) LockStripe
+    {
+        std::shared_mutex mutex;
+    };
+
+    static constexpr std::size_t LockStripeCount{ 64 };
 
-    std::mutex m_mutex;
+    mutable std::array<LockStripe, LockStripeCount> m_lockStripes;
 
-    boost::asio::thread_pool m_threadPool{ 4 };
+    TaskScheduler m_scheduler;
 };
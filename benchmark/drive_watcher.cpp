@@ -0,0 +1,811 @@
+#include "drive_watcher.h"
+
+#ifdef __linux__
+
+#include "directory_reader.h"
+#include "drive_scanner.h"
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+// Large enough to hold many events at once, even though each one may carry a name of up to
+// NAME_MAX bytes:
+constexpr std::size_t BufferSize{ 256 * 1024 };
+
+constexpr std::uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_FROM |
+                                    IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+// Directories that receive more events per batch than this get their children hashed by name,
+// rather than searched for each event:
+constexpr std::size_t LookupThreshold{ 16 };
+
+// When scanning a new directory, the directories along the way down are kept open, so that their
+// subdirectories can be opened relative to them. Deeper directories are opened by walking down
+// from the deepest one that's still open instead, so as not to run out of descriptors:
+constexpr std::size_t MaximumOpenAncestors{ 64 };
+
+/**
+ * @returns True if the full name of the Node, including its extension, matches |name|.
+ */
+bool HasName(const DriveWatcher::NodeType& node, std::string_view name)
+{
+    const std::string_view stem = node->name;
+    if (name.size() < stem.size() || name.substr(0, stem.size()) != stem) {
+        return false;
+    }
+
+    const auto extension = node->extensionId != ExtensionDictionary::NoExtension
+                               ? node->GetExtension()
+                               : std::string_view{};
+
+    return name.substr(stem.size()) == extension;
+}
+
+DriveWatcher::NodeType* FindChild(const DriveWatcher::NodeType& directory, std::string_view name)
+{
+    for (auto* child = directory.GetFirstChild(); child; child = child->GetNextSibling()) {
+        if (HasName(*child, name)) {
+            return child;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Adds |sizeDelta| and |fileCountDelta| to the totals of the specified directory, and to
+ * those of all its ancestors.
+ */
+void PropagateSizeChange(
+    DriveWatcher::NodeType* directory, std::intmax_t sizeDelta,
+    std::intmax_t fileCountDelta) noexcept
+{
+    if (!directory || (sizeDelta == 0 && fileCountDelta == 0)) {
+        return;
+    }
+
+    directory->InvalidateSubtreeHash();
+
+    // Unsigned arithmetic wraps around, so adding the two's complement of a negative delta
+    // subtracts it:
+    for (auto* node = directory; node; node = node->GetParent()) {
+        (*node)->size += static_cast<std::uintmax_t>(sizeDelta);
+        (*node)->EditDirectoryDetails().fileCount += static_cast<std::uintmax_t>(fileCountDelta);
+    }
+}
+
+/**
+ * @returns The number of ancestors that the Node has.
+ */
+std::size_t GetDepth(const DriveWatcher::NodeType& node) noexcept
+{
+    std::size_t depth{ 0 };
+    for (const auto* ancestor = node.GetParent(); ancestor; ancestor = ancestor->GetParent()) {
+        ++depth;
+    }
+
+    return depth;
+}
+
+/**
+ * @returns The number of regular files that the Node accounts for.
+ */
+std::intmax_t CountFiles(const DriveWatcher::NodeType& node) noexcept
+{
+    return node->type == FileType::Directory
+               ? static_cast<std::intmax_t>(node->GetDirectoryDetails().fileCount)
+               : 1;
+}
+
+/**
+ * @brief Closes a file descriptor once it goes out of scope.
+ */
+class ScopedDescriptor
+{
+  public:
+    explicit ScopedDescriptor(int descriptor = -1) noexcept : m_descriptor{ descriptor }
+    {
+    }
+
+    ~ScopedDescriptor()
+    {
+        if (m_descriptor >= 0) {
+            close(m_descriptor);
+        }
+    }
+
+    ScopedDescriptor(const ScopedDescriptor&) = delete;
+    ScopedDescriptor& operator=(const ScopedDescriptor&) = delete;
+
+    ScopedDescriptor(ScopedDescriptor&& other) noexcept
+        : m_descriptor{ std::exchange(other.m_descriptor, -1) }
+    {
+    }
+
+    ScopedDescriptor& operator=(ScopedDescriptor&& other) noexcept
+    {
+        if (this != &other) {
+            if (m_descriptor >= 0) {
+                close(m_descriptor);
+            }
+
+            m_descriptor = std::exchange(other.m_descriptor, -1);
+        }
+
+        return *this;
+    }
+
+    bool IsValid() const noexcept
+    {
+        return m_descriptor >= 0;
+    }
+
+    int Get() const noexcept
+    {
+        return m_descriptor;
+    }
+
+  private:
+    int m_descriptor;
+};
+
+constexpr auto OpenDirectoryFlags = O_PATH | O_DIRECTORY | O_CLOEXEC;
+
+/**
+ * @brief Opens the directory that the Node represents, which lies |levels| below the open
+ * directory that |ancestorDescriptor| refers to.
+ *
+ * Each directory along the way is opened by name, relative to the one above it, so that the full
+ * path never needs to be resolved at once, and so can't exceed PATH_MAX. Symbolic links that have
+ * taken the place of any of these directories aren't followed. No more than two descriptors are
+ * open at any time.
+ */
+ScopedDescriptor OpenDirectory(
+    const DriveWatcher::NodeType& directory, std::size_t levels, int ancestorDescriptor)
+{
+    if (levels == 1) {
+        return ScopedDescriptor{ openat(
+            ancestorDescriptor, directory->name.c_str(), OpenDirectoryFlags | O_NOFOLLOW) };
+    }
+
+    const auto parentDescriptor =
+        OpenDirectory(*directory.GetParent(), levels - 1, ancestorDescriptor);
+
+    if (!parentDescriptor.IsValid()) {
+        return ScopedDescriptor{};
+    }
+
+    return ScopedDescriptor{ openat(
+        parentDescriptor.Get(), directory->name.c_str(), OpenDirectoryFlags | O_NOFOLLOW) };
+}
+
+/**
+ * @brief Opens the directory that the Node represents, for use as the starting point of `fstatat`
+ * and `openat` calls. The root is opened by its path, and may be reached through a symbolic link,
+ * just as with the DriveScanner.
+ */
+ScopedDescriptor OpenDirectory(const DriveWatcher::NodeType& directory)
+{
+    std::size_t depth{ 0 };
+
+    const auto* root = &directory;
+    for (; root->GetParent(); root = root->GetParent()) {
+        ++depth;
+    }
+
+    ScopedDescriptor rootDescriptor{ open((*root)->name.c_str(), OpenDirectoryFlags) };
+    if (depth == 0 || !rootDescriptor.IsValid()) {
+        return rootDescriptor;
+    }
+
+    return OpenDirectory(directory, depth, rootDescriptor.Get());
+}
+} // namespace
+
+DriveWatcher::DriveWatcher(DriveScanner& scanner)
+    : m_scanner{ scanner },
+      m_tree{ scanner.GetTree() },
+      m_descriptor{ inotify_init1(IN_NONBLOCK | IN_CLOEXEC) },
+      m_buffer{ std::make_unique<char[]>(BufferSize) }
+{
+    if (!IsValid()) {
+        return;
+    }
+
+    const auto& options = m_scanner.m_options;
+
+    // Of a directory that was reached through several paths, only one occurrence was enumerated,
+    // and only that one can hold any entries, so those occurrences are watched first:
+    FileIdentitySet watchedDirectories;
+
+    for (const auto hasEntries : { true, false }) {
+        std::for_each(m_tree->beginPreOrder(), m_tree->endPreOrder(), [&](auto& node) {
+            if (node->type != FileType::Directory || node.HasChildren() != hasEntries) {
+                return;
+            }
+
+            // Directories beyond the maximum depth, and mount points, were kept, but not
+            // enumerated, so there's nothing to keep up to date:
+            const auto& stamp = node->GetDirectoryDetails().stamp;
+            const auto isMountPoint =
+                options.stayOnFileSystem && stamp.device != m_scanner.m_rootDevice;
+
+            if (!m_scanner.IsWithinMaximumDepth(node) || isMountPoint) {
+                return;
+            }
+
+            if (options.skipRepeatedDirectories && stamp.IsKnown() &&
+                !watchedDirectories.Insert({ stamp.device, stamp.inode })) {
+                return;
+            }
+
+            DriveScanner::BuildPath(node, m_path);
+            Watch(node, m_path);
+        });
+    }
+}
+
+DriveWatcher::~DriveWatcher()
+{
+    if (m_descriptor >= 0) {
+        close(m_descriptor);
+    }
+}
+
+bool DriveWatcher::IsValid() const noexcept
+{
+    return m_descriptor >= 0 && m_tree && m_tree->GetRoot();
+}
+
+std::size_t DriveWatcher::ProcessEvents(std::chrono::milliseconds timeout)
+{
+    pollfd descriptor{ m_descriptor, POLLIN, 0 };
+    if (!IsValid() || poll(&descriptor, 1, static_cast<int>(timeout.count())) <= 0) {
+        return 0;
+    }
+
+    m_pendingEntries.clear();
+    m_pendingRenames.clear();
+
+    std::size_t eventCount{ 0 };
+
+    // Drain everything that has arrived so far, so that a storm of events is handled as a whole:
+    while (true) {
+        const auto bytesRead = read(m_descriptor, m_buffer.get(), BufferSize);
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        for (std::size_t position = 0; position < static_cast<std::size_t>(bytesRead);) {
+            const auto* const event =
+                reinterpret_cast<const inotify_event*>(m_buffer.get() + position);
+
+            position += sizeof(inotify_event) + event->len;
+            ++eventCount;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                m_hasOverflowed = true;
+                continue;
+            }
+
+            const auto itr = m_directories.find(event->wd);
+            if (itr == std::end(m_directories)) {
+                continue;
+            }
+
+            if (event->mask & IN_IGNORED) {
+                // The directory is gone, or no longer reachable; the kernel dropped its watch. Its
+                // stamp no longer applies, so a new directory that takes its place will be scanned
+                // anew, even if it happens to reuse the same inode:
+                auto& directory = *itr->second;
+                ReleaseDirectory(directory);
+                directory->EditDirectoryDetails().stamp = DirectoryStamp{};
+                directory.InvalidateSubtreeHash();
+
+                m_watches.erase(itr->second);
+                m_directories.erase(itr);
+                continue;
+            }
+
+            if (event->len == 0) {
+                continue;
+            }
+
+            const std::string_view name{ event->name };
+
+            if (event->mask & IN_MOVED_FROM) {
+                m_pendingRenames[event->cookie] = PendingRename{ event->wd, std::string{ name } };
+            } else if (event->mask & IN_MOVED_TO) {
+                const auto source = m_pendingRenames.find(event->cookie);
+                if (source != std::end(m_pendingRenames)) {
+                    ApplyRename(source->second, *itr->second, name);
+                    m_pendingRenames.erase(source);
+                }
+            }
+
+            // Every entry is checked against the disk at the end of the batch, which also covers
+            // renames whose other half happened outside of the tree:
+            m_pendingEntries.push_back(PendingEntry{ event->wd, std::string{ name } });
+        }
+    }
+
+    const auto byEntry = [](const PendingEntry& lhs, const PendingEntry& rhs) {
+        return std::tie(lhs.watch, lhs.name) < std::tie(rhs.watch, rhs.name);
+    };
+
+    const auto isSameEntry = [](const PendingEntry& lhs, const PendingEntry& rhs) {
+        return lhs.watch == rhs.watch && lhs.name == rhs.name;
+    };
+
+    std::sort(std::begin(m_pendingEntries), std::end(m_pendingEntries), byEntry);
+    m_pendingEntries.erase(
+        std::unique(std::begin(m_pendingEntries), std::end(m_pendingEntries), isSameEntry),
+        std::end(m_pendingEntries));
+
+    std::unordered_map<std::string, NodeType*> children;
+
+    for (auto first = std::begin(m_pendingEntries); first != std::end(m_pendingEntries);) {
+        const auto last = std::find_if(first, std::end(m_pendingEntries), [&](const auto& entry) {
+            return entry.watch != first->watch;
+        });
+
+        // Watches are looked up again, since directories may have been removed in the meantime:
+        const auto itr = m_directories.find(first->watch);
+        if (itr == std::end(m_directories)) {
+            first = last;
+            continue;
+        }
+
+        auto& directory = *itr->second;
+
+        // If the directory can't be opened, nothing can be said about its entries. Should it be
+        // gone, then its Node will be removed along with the entry in its parent:
+        const auto directoryDescriptor = OpenDirectory(directory);
+        if (!directoryDescriptor.IsValid()) {
+            first = last;
+            continue;
+        }
+
+        const auto useLookup = static_cast<std::size_t>(last - first) > LookupThreshold;
+        if (useLookup) {
+            children.clear();
+            for (auto* child = directory.GetFirstChild(); child; child = child->GetNextSibling()) {
+                auto name = (*child)->name;
+                if ((*child)->extensionId != ExtensionDictionary::NoExtension) {
+                    name += (*child)->GetExtension();
+                }
+
+                children.emplace(std::move(name), child);
+            }
+        }
+
+        // Since every name only occurs once per directory, entries that are removed from the
+        // lookup table along the way will never be looked up again:
+        for (; first != last; ++first) {
+            NodeType* child = nullptr;
+            if (useLookup) {
+                const auto match = children.find(first->name);
+                child = match != std::end(children) ? match->second : nullptr;
+            } else {
+                child = FindChild(directory, first->name);
+            }
+
+            Reconcile(directory, directoryDescriptor.Get(), first->name, child);
+        }
+    }
+
+    return eventCount;
+}
+
+std::size_t DriveWatcher::GetUnwatchedDirectoryCount() const noexcept
+{
+    return m_unwatchedDirectoryCount;
+}
+
+bool DriveWatcher::HasOverflowed() const noexcept
+{
+    return m_hasOverflowed;
+}
+
+std::size_t DriveWatcher::GetUnscannedDirectoryCount() const noexcept
+{
+    return m_unscannedDirectoryCount;
+}
+
+void DriveWatcher::Watch(NodeType& directory, const std::string& path)
+{
+    Track(directory, inotify_add_watch(m_descriptor, path.c_str(), WatchMask));
+}
+
+void DriveWatcher::Watch(NodeType& directory, int descriptor)
+{
+    // Going through the descriptor's link in `/proc` watches the very directory that was opened,
+    // without resolving its full path. The link has to be followed for that, though:
+    const auto link = "/proc/self/fd/" + std::to_string(descriptor);
+    auto watch = inotify_add_watch(m_descriptor, link.c_str(), WatchMask & ~IN_DONT_FOLLOW);
+
+    // Without `/proc`, the directory's path is the only option:
+    if (watch < 0 && errno == ENOENT) {
+        DriveScanner::BuildPath(directory, m_path);
+        watch = inotify_add_watch(m_descriptor, m_path.c_str(), WatchMask);
+    }
+
+    Track(directory, watch);
+}
+
+void DriveWatcher::Track(NodeType& directory, int watch)
+{
+    if (watch < 0) {
+        ++m_unwatchedDirectoryCount;
+        return;
+    }
+
+    // The kernel hands out the same watch again if the directory was already being watched, which
+    // happens when a Node that was moved outside of the watcher's knowledge is scanned again:
+    const auto [itr, wasInserted] = m_directories.try_emplace(watch, &directory);
+    if (!wasInserted) {
+        m_watches.erase(itr->second);
+        itr->second = &directory;
+    }
+
+    m_watches[&directory] = watch;
+}
+
+void DriveWatcher::Unwatch(NodeType& node)
+{
+    if (node->type != FileType::Directory) {
+        return;
+    }
+
+    for (auto* child = node.GetFirstChild(); child; child = child->GetNextSibling()) {
+        Unwatch(*child);
+    }
+
+    const auto itr = m_watches.find(&node);
+    if (itr == std::end(m_watches)) {
+        return;
+    }
+
+    inotify_rm_watch(m_descriptor, itr->second);
+    ReleaseDirectory(node);
+
+    m_directories.erase(itr->second);
+    m_watches.erase(itr);
+}
+
+void DriveWatcher::ReleaseDirectory(const NodeType& directory)
+{
+    // Only enumerated directories are watched, and each of those holds the claim to its identity,
+    // which allows a directory that takes its place to be enumerated in turn:
+    const auto& stamp = directory->GetDirectoryDetails().stamp;
+    if (m_scanner.m_options.skipRepeatedDirectories && stamp.IsKnown()) {
+        m_scanner.m_visitedDirectories.Erase({ stamp.device, stamp.inode });
+    }
+}
+
+void DriveWatcher::ApplyRename(
+    const PendingRename& source, NodeType& destinationDirectory, std::string_view name)
+{
+    const auto itr = m_directories.find(source.watch);
+    if (itr == std::end(m_directories)) {
+        return;
+    }
+
+    auto* const node = FindChild(*itr->second, source.name);
+    if (!node) {
+        return;
+    }
+
+    // A subtree that was shaped by path exclusions or by the maximum depth might be shaped
+    // differently at its new location, in which case the destination is scanned anew instead:
+    const auto& options = m_scanner.m_options;
+    const auto hasFiniteDepth = options.maximumDepth != std::numeric_limits<std::size_t>::max();
+
+    if ((*node)->type == FileType::Directory &&
+        (!m_scanner.m_pathExclusions.empty() ||
+         (hasFiniteDepth && GetDepth(*node) != GetDepth(destinationDirectory) + 1))) {
+        Remove(*node);
+        return;
+    }
+
+    // A rename replaces whatever was there before:
+    auto* const replacedNode = FindChild(destinationDirectory, name);
+    if (replacedNode && replacedNode != node) {
+        Remove(*replacedNode);
+    }
+
+    const auto size = static_cast<std::intmax_t>((*node)->size);
+    const auto fileCount = CountFiles(*node);
+    PropagateSizeChange(node->GetParent(), -size, -fileCount);
+
+    // Watches follow the directory itself, so the moved subtree stays watched as it is:
+    destinationDirectory.AppendChild(*node);
+
+    if ((*node)->type == FileType::Directory) {
+        (*node)->name = std::string{ name };
+    } else {
+        auto renamedInfo = MakeRegularFileInfo(std::string{ name }, (*node)->size);
+        (*node)->name = std::move(renamedInfo.name);
+        (*node)->extensionId = renamedInfo.extensionId;
+    }
+
+    node->InvalidateSubtreeHash();
+    PropagateSizeChange(&destinationDirectory, size, fileCount);
+}
+
+void DriveWatcher::Reconcile(
+    NodeType& directory, int descriptor, const std::string& name, NodeType* child)
+{
+    // Excluded entries never make it into the tree, not even by being renamed into it:
+    if (IsExcluded(directory, name)) {
+        if (child) {
+            Remove(*child);
+        }
+
+        return;
+    }
+
+    struct stat status;
+    if (fstatat(descriptor, name.c_str(), &status, AT_SYMLINK_NOFOLLOW) != 0) {
+        // Only an entry that's known to be gone is removed. Any other error, such as a lack of
+        // permissions or memory, says nothing about the entry, so its Node is left as it is:
+        if (child && (errno == ENOENT || errno == ENOTDIR)) {
+            Remove(*child);
+        }
+
+        return;
+    }
+
+    const auto& options = m_scanner.m_options;
+    const auto size = static_cast<std::uintmax_t>(status.st_size);
+
+    // Just like with the DriveScanner, files below the minimum size aren't kept, and neither are
+    // further links to a file that's already been counted. A file that's already in the tree is
+    // the link that was counted:
+    const auto isRepeatedLink =
+        options.countHardLinksOnce && S_ISREG(status.st_mode) && status.st_nlink > 1 &&
+        !(child && (*child)->type == FileType::Regular) &&
+        !m_scanner.m_visitedFiles.Insert({ static_cast<std::uint64_t>(status.st_dev),
+                                           static_cast<std::uint64_t>(status.st_ino) });
+
+    if (S_ISREG(status.st_mode) && size > 0 && size >= options.minimumFileSize &&
+        !isRepeatedLink) {
+        if (child && (*child)->type == FileType::Regular) {
+            const auto delta =
+                static_cast<std::intmax_t>(size) - static_cast<std::intmax_t>((*child)->size);
+
+            (*child)->size = size;
+            child->InvalidateSubtreeHash();
+
+            PropagateSizeChange(&directory, delta, 0);
+            return;
+        }
+
+        if (child) {
+            Remove(*child);
+        }
+
+        directory.AppendChild(MakeRegularFileInfo(name, size));
+        PropagateSizeChange(&directory, static_cast<std::intmax_t>(size), 1);
+        return;
+    }
+
+    if (S_ISDIR(status.st_mode)) {
+        // A directory that was replaced by a new one with the same name needs to be scanned anew.
+        // Directories beyond the maximum depth are never enumerated, so any directory will do:
+        const auto& stamp = child ? (*child)->GetDirectoryDetails().stamp : DirectoryStamp{};
+        const auto isSameDirectory =
+            child && (*child)->type == FileType::Directory &&
+            (!m_scanner.IsWithinMaximumDepth(*child) ||
+             (stamp.device == status.st_dev && stamp.inode == status.st_ino));
+
+        if (isSameDirectory) {
+            return;
+        }
+
+        if (child) {
+            Remove(*child);
+        }
+
+        auto* const subdirectory = directory.AppendChild(
+            MakeDirectoryInfo(name, DriveScanner::UndefinedSize));
+
+        ScanDirectory(*subdirectory, descriptor);
+        PropagateSizeChange(
+            &directory, static_cast<std::intmax_t>((*subdirectory)->size),
+            CountFiles(*subdirectory));
+        return;
+    }
+
+    // The entry is no longer something that the DriveScanner would have kept, such as an empty
+    // file or a symbolic link:
+    if (child) {
+        Remove(*child);
+    }
+}
+
+void DriveWatcher::ScanDirectory(NodeType& directory, int parentDescriptor)
+{
+    // The directories that still need to be read, along with their depth below |directory|:
+    struct PendingScan
+    {
+        NodeType* directory;
+        std::size_t depth;
+    };
+
+    std::vector<PendingScan> pendingScans{ { &directory, 0 } };
+
+    // Every directory that was read, in the order in which they were read, which puts each one
+    // after its parent:
+    std::vector<NodeType*> scannedDirectories;
+
+    // Each directory is read in full before any of its subdirectories, so only its ancestors, which
+    // are indexed by their depth, need to stay open:
+    std::vector<ScopedDescriptor> openAncestors;
+
+    std::vector<DirectoryEntry> entries;
+
+    const auto& options = m_scanner.m_options;
+
+    while (!pendingScans.empty()) {
+        const auto [current, depth] = pendingScans.back();
+        pendingScans.pop_back();
+
+        // Directories beyond the maximum depth are kept, but never enumerated:
+        if (!m_scanner.IsWithinMaximumDepth(*current)) {
+            continue;
+        }
+
+        // Since the scan is depth-first, the last directory that was read at each shallower depth
+        // is an ancestor of this one:
+        if (openAncestors.size() > depth) {
+            openAncestors.erase(std::begin(openAncestors) + depth, std::end(openAncestors));
+        }
+
+        ScopedDescriptor reopenedParent;
+        auto parent = parentDescriptor;
+
+        if (depth > 0 && depth <= openAncestors.size()) {
+            parent = openAncestors[depth - 1].Get();
+        } else if (depth > 0) {
+            reopenedParent = openAncestors.empty()
+                                 ? OpenDirectory(*current->GetParent())
+                                 : OpenDirectory(
+                                       *current->GetParent(), depth - openAncestors.size(),
+                                       openAncestors.back().Get());
+
+            parent = reopenedParent.Get();
+        }
+
+        // Like the DriveScanner, this won't follow a symbolic link that has taken the place of the
+        // directory:
+        DirectoryReader reader{ parent, (*current)->name.c_str() };
+        if (!reader.IsValid()) {
+            ++m_unscannedDirectoryCount;
+            continue;
+        }
+
+        const auto stamp =
+            DriveScanner::ReadDirectoryStamp(reader.GetDescriptor()).value_or(DirectoryStamp{});
+
+        (*current)->EditDirectoryDetails().stamp = stamp;
+
+        // Mount points are kept, but not enumerated:
+        if (options.stayOnFileSystem && stamp.device != m_scanner.m_rootDevice) {
+            continue;
+        }
+
+        // Just like during the scan, whichever path to a directory is enumerated first claims it:
+        if (options.skipRepeatedDirectories && stamp.IsKnown() &&
+            !m_scanner.m_visitedDirectories.Insert({ stamp.device, stamp.inode })) {
+            continue;
+        }
+
+        // Watching the directory before reading it ensures that entries created in the meantime
+        // will show up as events:
+        Watch(*current, reader.GetDescriptor());
+
+        // Path exclusions need the location of the directory:
+        if (!m_scanner.m_pathExclusions.empty()) {
+            DriveScanner::BuildPath(*current, m_path);
+        }
+
+        std::uintmax_t size{ 0 };
+        std::uintmax_t fileCount{ 0 };
+
+        const auto subdirectoriesStart = pendingScans.size();
+
+        while (reader.ReadBatch(entries)) {
+            entries.erase(
+                std::remove_if(
+                    std::begin(entries), std::end(entries),
+                    [&](const DirectoryEntry& entry) {
+                        return m_scanner.IsExcluded(m_path, entry.name);
+                    }),
+                std::end(entries));
+
+            reader.ResolveMetadata(entries);
+
+            for (const auto& entry : entries) {
+                const auto isRepeatedLink = entry.type == EntryType::Regular &&
+                                            options.countHardLinksOnce && entry.linkCount > 1 &&
+                                            !m_scanner.m_visitedFiles.Insert(entry.identity);
+
+                if (entry.type == EntryType::Regular && entry.size > 0 &&
+                    entry.size >= options.minimumFileSize && !isRepeatedLink) {
+                    current->AppendChild(MakeRegularFileInfo(std::string{ entry.name }, entry.size));
+                    size += entry.size;
+                    ++fileCount;
+                } else if (entry.type == EntryType::Directory) {
+                    auto* const subdirectory = current->AppendChild(
+                        MakeDirectoryInfo(std::string{ entry.name }, DriveScanner::UndefinedSize));
+
+                    pendingScans.push_back({ subdirectory, depth + 1 });
+                }
+            }
+        }
+
+        // The totals of the subdirectories are added once those have been read:
+        (*current)->size = size;
+        (*current)->EditDirectoryDetails().fileCount = fileCount;
+
+        scannedDirectories.push_back(current);
+
+        if (pendingScans.size() > subdirectoriesStart && depth < MaximumOpenAncestors) {
+            openAncestors.emplace_back(reader.ReleaseDescriptor());
+        }
+    }
+
+    // Going in reverse, every directory has its totals completed by its subdirectories before
+    // they're added to its parent in turn:
+    for (auto itr = std::rbegin(scannedDirectories); itr != std::rend(scannedDirectories); ++itr) {
+        auto* const scannedDirectory = *itr;
+        if (scannedDirectory == &directory) {
+            continue;
+        }
+
+        auto& parent = *scannedDirectory->GetParent();
+        parent->size += (*scannedDirectory)->size;
+        parent->EditDirectoryDetails().fileCount +=
+            (*scannedDirectory)->GetDirectoryDetails().fileCount;
+    }
+
+    // Appending children already marked the hash as stale, but an empty directory still had its
+    // size and stamp changed:
+    directory.InvalidateSubtreeHash();
+}
+
+bool DriveWatcher::IsExcluded(const NodeType& directory, std::string_view name)
+{
+    // Only path exclusions need the location of the directory:
+    if (m_scanner.m_pathExclusions.empty()) {
+        m_path.clear();
+    } else {
+        DriveScanner::BuildPath(directory, m_path);
+    }
+
+    return m_scanner.IsExcluded(m_path, name);
+}
+
+void DriveWatcher::Remove(NodeType& node)
+{
+    Unwatch(node);
+    PropagateSizeChange(
+        node.GetParent(), -static_cast<std::intmax_t>(node->size), -CountFiles(node));
+
+    node.DeleteFromTree();
+}
+
+#endif // Linux
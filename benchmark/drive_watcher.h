@@ -0,0 +1,155 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "file_info.h"
+#include "tree.h"
+
+class DriveScanner;
+
+/**
+ * @brief Keeps a scanned tree up to date by applying file system events to it as they happen.
+ *
+ * Every directory that the scan enumerated is watched through inotify. Events are read in batches, and all
+ * events that concern the same directory entry within a batch are coalesced, so that an entry is
+ * only stat'ed once per batch, no matter how many events it produced. The tree is then updated to
+ * match what's on disk. Renames within the tree move the existing Node, along with its subtree,
+ * rather than scanning it again. Each mutation adjusts the sizes and file counts along its ancestor
+ * chain, so that the totals of directories stay accurate without being recomputed. Everything that
+ * the watcher adds to the tree is subject to the same ScanOptions as the scan itself.
+ *
+ * Directories that are reachable through several paths, and files with several hard links, are
+ * claimed in the scanner's own sets, so the watcher won't add what the scan already counted.
+ * However, removing the link to a file that was counted doesn't credit any of the file's other
+ * links, and a file with several links that leaves the tree remains claimed, until the tree is
+ * scanned again. Since watches belong to directories rather than to paths, a directory that was
+ * enumerated through several paths is only kept up to date at one of them.
+ *
+ * The watcher isn't thread-safe. The tree is only mutated from within ProcessEvents(...), so
+ * reading the tree needs to be synchronized with calls to it.
+ *
+ * @note Watches are a limited resource (see `/proc/sys/fs/inotify/max_user_watches`). Directories
+ * that can't be watched won't be kept up to date; see GetUnwatchedDirectoryCount(). Likewise, new
+ * directories that can't be read are kept empty; see GetUnscannedDirectoryCount().
+ */
+class DriveWatcher
+{
+  public:
+    using NodeType = Tree<FileInfo>::Node;
+
+    /**
+     * @brief Starts watching every directory that the specified scanner enumerated.
+     *
+     * @param[in] scanner             A scanner that has completed its scan. It needs to outlive
+     *                                the watcher, and mustn't scan again while the watcher is in
+     *                                use. Its tree shouldn't be modified by anything other than
+     *                                this watcher from here on.
+     */
+    explicit DriveWatcher(DriveScanner& scanner);
+
+    ~DriveWatcher();
+
+    DriveWatcher(const DriveWatcher&) = delete;
+    DriveWatcher& operator=(const DriveWatcher&) = delete;
+
+    /**
+     * @returns True if inotify could be initialized.
+     */
+    bool IsValid() const noexcept;
+
+    /**
+     * @brief Waits for events to arrive, and then applies every event that is available as a
+     * single batch.
+     *
+     * @param[in] timeout             How long to wait for the first event.
+     *
+     * @returns The number of events that were read.
+     */
+    std::size_t ProcessEvents(std::chrono::milliseconds timeout);
+
+    /**
+     * @returns The number of directories that couldn't be watched.
+     */
+    std::size_t GetUnwatchedDirectoryCount() const noexcept;
+
+    /**
+     * @returns The number of new directories that couldn't be read, which are kept as empty
+     * directories.
+     */
+    std::size_t GetUnscannedDirectoryCount() const noexcept;
+
+    /**
+     * @returns True if the kernel had to drop events, in which case the tree can no longer be
+     * trusted, and should be rescanned.
+     */
+    bool HasOverflowed() const noexcept;
+
+  private:
+    // A directory entry that at least one event in the current batch referred to. Directories are
+    // identified by their watch, since their Nodes may be deleted while the batch is processed:
+    struct PendingEntry
+    {
+        int watch;
+        std::string name;
+    };
+
+    // The source of a rename, waiting to be paired with its destination:
+    struct PendingRename
+    {
+        int watch;
+        std::string name;
+    };
+
+    void Watch(NodeType& directory, const std::string& path);
+
+    void Watch(NodeType& directory, int descriptor);
+
+    void Track(NodeType& directory, int watch);
+
+    void Unwatch(NodeType& node);
+
+    void ReleaseDirectory(const NodeType& directory);
+
+    void ApplyRename(
+        const PendingRename& source, NodeType& destinationDirectory, std::string_view name);
+
+    void Reconcile(NodeType& directory, int descriptor, const std::string& name, NodeType* child);
+
+    void ScanDirectory(NodeType& directory, int parentDescriptor);
+
+    void Remove(NodeType& node);
+
+    bool IsExcluded(const NodeType& directory, std::string_view name);
+
+    DriveScanner& m_scanner;
+
+    std::shared_ptr<Tree<FileInfo>> m_tree;
+
+    int m_descriptor;
+
+    std::unique_ptr<char[]> m_buffer;
+
+    std::unordered_map<int, NodeType*> m_directories;
+    std::unordered_map<const NodeType*, int> m_watches;
+
+    // Reused between batches, so that processing a batch doesn't usually allocate:
+    std::vector<PendingEntry> m_pendingEntries;
+    std::unordered_map<std::uint32_t, PendingRename> m_pendingRenames;
+    std::string m_path;
+
+    std::size_t m_unwatchedDirectoryCount{ 0 };
+    std::size_t m_unscannedDirectoryCount{ 0 };
+
+    bool m_hasOverflowed{ false };
+};
+
+#endif // Linux
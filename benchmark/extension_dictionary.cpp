@@ -0,0 +1,61 @@
+#include "extension_dictionary.h"
+
+#include <cassert>
+#include <mutex>
+
+ExtensionDictionary::ExtensionDictionary()
+{
+    m_extensions.emplace_back();
+    m_identifiers.emplace(m_extensions.back(), NoExtension);
+}
+
+ExtensionId ExtensionDictionary::Intern(std::string_view extension)
+{
+    if (extension.empty()) {
+        return NoExtension;
+    }
+
+    {
+        // The vast majority of lookups will be for extensions that have been seen before:
+        const std::shared_lock<decltype(m_mutex)> lock{ m_mutex };
+
+        const auto itr = m_identifiers.find(extension);
+        if (itr != std::end(m_identifiers)) {
+            return itr->second;
+        }
+    }
+
+    const std::unique_lock<decltype(m_mutex)> lock{ m_mutex };
+
+    // Another thread may have added the same extension in the meantime:
+    const auto itr = m_identifiers.find(extension);
+    if (itr != std::end(m_identifiers)) {
+        return itr->second;
+    }
+
+    const auto identifier = static_cast<ExtensionId>(m_extensions.size());
+    m_extensions.emplace_back(extension);
+    m_identifiers.emplace(m_extensions.back(), identifier);
+
+    return identifier;
+}
+
+std::string_view ExtensionDictionary::GetExtension(ExtensionId identifier) const
+{
+    const std::shared_lock<decltype(m_mutex)> lock{ m_mutex };
+
+    assert(identifier < m_extensions.size());
+    return m_extensions[identifier];
+}
+
+std::size_t ExtensionDictionary::Size() const
+{
+    const std::shared_lock<decltype(m_mutex)> lock{ m_mutex };
+    return m_extensions.size();
+}
+
+ExtensionDictionary& ExtensionDictionary::Shared()
+{
+    static ExtensionDictionary dictionary;
+    return dictionary;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief A compact identifier for an interned file extension.
+ */
+using ExtensionId = std::uint32_t;
+
+/**
+ * @brief A thread-safe dictionary of file extensions.
+ *
+ * Every distinct extension is stored exactly once, and is identified by a small integer, so that
+ * nodes don't each need to own a copy of the same handful of strings, and so that extensions can
+ * be compared by identifier. Extensions are never removed, so identifiers, as well as the views
+ * handed out by the dictionary, remain valid for the lifetime of the dictionary.
+ */
+class ExtensionDictionary
+{
+  public:
+    /**
+     * @brief The identifier of the empty extension.
+     */
+    static constexpr ExtensionId NoExtension{ 0 };
+
+    ExtensionDictionary();
+
+    ExtensionDictionary(const ExtensionDictionary&) = delete;
+    ExtensionDictionary& operator=(const ExtensionDictionary&) = delete;
+
+    /**
+     * @returns The identifier of the specified extension, which is added to the dictionary if it
+     * isn't already present.
+     */
+    ExtensionId Intern(std::string_view extension);
+
+    /**
+     * @returns The extension that is identified by the specified identifier.
+     */
+    std::string_view GetExtension(ExtensionId identifier) const;
+
+    /**
+     * @returns The number of distinct extensions in the dictionary, including the empty extension.
+     */
+    std::size_t Size() const;
+
+    /**
+     * @returns The dictionary that is shared by all FileInfo instances.
+     */
+    static ExtensionDictionary& Shared();
+
+  private:
+    mutable std::shared_mutex m_mutex;
+
+    // A deque never relocates its elements, so views into these strings remain valid:
+    std::deque<std::string> m_extensions;
+    std::unordered_map<std::string_view, ExtensionId> m_identifiers;
+};
@@ -0,0 +1,37 @@
+#include "file_identity_set.h"
+
+bool FileIdentitySet::Insert(const FileIdentity& identity)
+{
+    auto& shard = m_shards[Hash{}(identity) % ShardCount];
+
+    const std::lock_guard<decltype(shard.mutex)> lock{ shard.mutex };
+    return shard.identities.insert(identity).second;
+}
+
+void FileIdentitySet::Erase(const FileIdentity& identity)
+{
+    auto& shard = m_shards[Hash{}(identity) % ShardCount];
+
+    const std::lock_guard<decltype(shard.mutex)> lock{ shard.mutex };
+    shard.identities.erase(identity);
+}
+
+void FileIdentitySet::Clear() noexcept
+{
+    for (auto& shard : m_shards) {
+        const std::lock_guard<decltype(shard.mutex)> lock{ shard.mutex };
+        shard.identities.clear();
+    }
+}
+
+std::size_t FileIdentitySet::Hash::operator()(const FileIdentity& identity) const noexcept
+{
+    // Inode numbers tend to be sequential, so they're mixed thoroughly before being used to pick
+    // both a shard, and a bucket within it:
+    auto hash = identity.inode * 0x9E3779B97F4A7C15ull ^ identity.device;
+    hash ^= hash >> 32;
+    hash *= 0xD6E8FEB86659FD93ull;
+    hash ^= hash >> 32;
+
+    return static_cast<std::size_t>(hash);
+}
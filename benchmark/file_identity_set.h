@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+
+/**
+ * @brief Identifies a file, or a directory, irrespective of the path it was reached through.
+ */
+struct FileIdentity
+{
+    bool operator==(const FileIdentity& other) const noexcept
+    {
+        return device == other.device && inode == other.inode;
+    }
+
+    std::uint64_t device;
+    std::uint64_t inode;
+};
+
+/**
+ * @brief A set of FileIdentity instances that many threads can insert into at once.
+ *
+ * The set is split into shards, each with its own lock, and each on its own cache line. Since an
+ * identity's shard is picked by its hash, threads rarely contend for the same shard.
+ */
+class FileIdentitySet
+{
+  public:
+    /**
+     * @brief Inserts the identity into the set.
+     *
+     * @returns True if the identity wasn't in the set yet.
+     */
+    bool Insert(const FileIdentity& identity);
+
+    /**
+     * @brief Removes the identity from the set, so that it can be inserted again.
+     */
+    void Erase(const FileIdentity& identity);
+
+    /**
+     * @brief Removes every identity from the set.
+     *
+     * @note Shouldn't be called while other threads are inserting.
+     */
+    void Clear() noexcept;
+
+  private:
+    struct Hash
+    {
+        std::size_t operator()(const FileIdentity& identity) const noexcept;
+    };
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        std::unordered_set<FileIdentity, Hash> identities;
+    };
+
+    static constexpr std::size_t ShardCount{ 64 };
+
+    std::array<Shard, ShardCount> m_shards;
+};
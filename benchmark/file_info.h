@@ -1,7 +1,13 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
+
+#include "extension_dictionary.h"
+#include "tree.h"
 
 /**
  * @brief The FILE_TYPE enum represents the three basic file types: non-directory files,
@@ -14,15 +20,371 @@ enum class FileType
     Symlink
 };
 
+/**
+ * @brief Identifies a directory, and the state that it was in when it was last scanned. Adding,
+ * removing, or renaming an entry updates the directory's modification time, so a directory whose
+ * stamp is unchanged still has the same entries.
+ *
+ * @note Modifying the contents of an existing file doesn't update the modification time of the
+ * directory that contains it.
+ */
+struct DirectoryStamp
+{
+    /**
+     * @returns True if the stamp was actually retrieved, rather than default-constructed.
+     */
+    bool IsKnown() const noexcept
+    {
+        return modificationTime != 0;
+    }
+
+    bool operator==(const DirectoryStamp& other) const noexcept
+    {
+        return device == other.device && inode == other.inode &&
+               modificationTime == other.modificationTime;
+    }
+
+    bool operator!=(const DirectoryStamp& other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+    std::uint64_t device;
+    std::uint64_t inode;
+
+    // In nanoseconds on Linux, and in the units of `std::filesystem::file_time_type` elsewhere:
+    std::int64_t modificationTime;
+};
+
+/**
+ * @brief The state that only directories keep track of.
+ */
+struct DirectoryDetails
+{
+    // Allows the directory to be skipped by incremental rescans:
+    DirectoryStamp stamp{};
+
+    // The number of regular files in the directory's subtree:
+    std::uintmax_t fileCount{ 0 };
+
+    // Set while the directory's subtree is still being scanned. The size and file count of such a
+    // directory don't cover its entire subtree yet:
+    bool isBeingScanned{ false };
+};
+
+/**
+ * @brief Owns the DirectoryDetails of a FileInfo. Unlike a plain `std::unique_ptr`, copying the
+ * holder copies the details, so that a FileInfo, and therefore a tree of them, remains copyable.
+ */
+class DirectoryDetailsHolder
+{
+  public:
+    DirectoryDetailsHolder() noexcept = default;
+
+    explicit DirectoryDetailsHolder(std::unique_ptr<DirectoryDetails> details) noexcept
+        : m_details{ std::move(details) }
+    {
+    }
+
+    DirectoryDetailsHolder(const DirectoryDetailsHolder& other)
+        : m_details{ other.m_details ? std::make_unique<DirectoryDetails>(*other.m_details)
+                                     : nullptr }
+    {
+    }
+
+    DirectoryDetailsHolder& operator=(const DirectoryDetailsHolder& other)
+    {
+        if (this != &other) {
+            m_details =
+                other.m_details ? std::make_unique<DirectoryDetails>(*other.m_details) : nullptr;
+        }
+
+        return *this;
+    }
+
+    DirectoryDetailsHolder(DirectoryDetailsHolder&&) noexcept = default;
+    DirectoryDetailsHolder& operator=(DirectoryDetailsHolder&&) noexcept = default;
+
+    /**
+     * @returns The details, or nullptr if none were allocated.
+     */
+    DirectoryDetails* Get() const noexcept
+    {
+        return m_details.get();
+    }
+
+    /**
+     * @returns The details, which are allocated if they don't exist yet.
+     */
+    DirectoryDetails& GetOrCreate()
+    {
+        if (!m_details) {
+            m_details = std::make_unique<DirectoryDetails>();
+        }
+
+        return *m_details;
+    }
+
+  private:
+    std::unique_ptr<DirectoryDetails> m_details;
+};
+
 /**
  * @brief The FileInfo struct
  */
 struct FileInfo
 {
+    /**
+     * @returns The file's extension, as stored in the shared ExtensionDictionary.
+     */
+    std::string_view GetExtension() const
+    {
+        return ExtensionDictionary::Shared().GetExtension(extensionId);
+    }
+
+    /**
+     * @returns The directory's details, or default-constructed details if none were recorded, as
+     * is the case for anything but a directory.
+     */
+    const DirectoryDetails& GetDirectoryDetails() const noexcept
+    {
+        static const DirectoryDetails none{};
+
+        const auto* const directoryDetails = details.Get();
+        return directoryDetails ? *directoryDetails : none;
+    }
+
+    /**
+     * @returns The directory's details, which are allocated the first time they're modified.
+     */
+    DirectoryDetails& EditDirectoryDetails()
+    {
+        return details.GetOrCreate();
+    }
+
     std::string name;
-    std::string extension;
 
     std::uintmax_t size;
 
+    // Identifies the file's extension in the shared ExtensionDictionary:
+    ExtensionId extensionId;
+
     FileType type;
+
+    // Only allocated for directories, since regular files vastly outnumber them:
+    DirectoryDetailsHolder details{};
+};
+
+/**
+ * @brief Subtree hashes allow successive snapshots of a drive to be diffed without revisiting
+ * unchanged subtrees. The scanner and the watcher only mark the hashes of the Nodes they change as
+ * stale; callers need to refresh them through `Tree::UpdateSubtreeHashes(...)` before diffing.
+ */
+template <> struct TreeTraits<FileInfo>
+{
+    static constexpr bool EnableSubtreeHashes = true;
+    static constexpr bool EnableChildIndex = false;
+};
+
+/**
+ * @brief Constructs the FileInfo of a regular file, interning its extension in the shared
+ * ExtensionDictionary.
+ *
+ * @param[in] fileName            The name of the file, including its extension.
+ * @param[in] fileSize            The size of the file, in bytes.
+ */
+inline FileInfo MakeRegularFileInfo(std::string fileName, std::uintmax_t fileSize)
+{
+    FileInfo fileInfo{ std::move(fileName), fileSize, ExtensionDictionary::NoExtension,
+                       FileType::Regular };
+
+    // Splitting the file name in place avoids materializing the extension as a separate string.
+    // As with `std::filesystem::path::extension()`, a leading dot doesn't start an extension:
+    const auto dot = fileInfo.name.rfind('.');
+    if (dot != std::string::npos && dot != 0) {
+        fileInfo.extensionId =
+            ExtensionDictionary::Shared().Intern(std::string_view{ fileInfo.name }.substr(dot));
+
+        fileInfo.name.resize(dot);
+    }
+
+    return fileInfo;
+}
+
+/**
+ * @brief Constructs the FileInfo of a directory whose size isn't known yet.
+ *
+ * @param[in] directoryName       The name of the directory.
+ * @param[in] directorySize       The placeholder size to use until the directory has been scanned.
+ */
+inline FileInfo MakeDirectoryInfo(std::string directoryName, std::uintmax_t directorySize)
+{
+    return FileInfo{ std::move(directoryName), directorySize, ExtensionDictionary::NoExtension,
+                     FileType::Directory,
+                     DirectoryDetailsHolder{ std::make_unique<DirectoryDetails>() } };
+}
+
+/**
+ * @brief A variant of FileInfo whose name is stored in a StringPool, rather than owned by each
+ * instance. This saves an allocation per name that doesn't fit in the small-string buffer, and
+ * makes releasing the names of an entire tree a matter of freeing a few large blocks.
+ *
+ * @note The StringPool needs to outlive every instance; see `MakePooledTree(...)`.
+ */
+struct PooledFileInfo
+{
+    /**
+     * @returns The file's extension, as stored in the shared ExtensionDictionary.
+     */
+    std::string_view GetExtension() const
+    {
+        return ExtensionDictionary::Shared().GetExtension(extensionId);
+    }
+
+    std::string_view name;
+
+    std::uintmax_t size;
+
+    // Identifies the file's extension in the shared ExtensionDictionary:
+    ExtensionId extensionId;
+
+    FileType type;
+};
+
+/**
+ * @brief Serialization codec for use with `TreeUtilities::Save(...)` and
+ * `TreeUtilities::Load(...)`.
+ */
+struct FileInfoCodec
+{
+    // Stores the name, extension, size, and type of each entry, followed by the DirectoryDetails
+    // of every directory. This needs to be bumped whenever that layout changes:
+    static constexpr std::uint32_t Version{ 1 };
+
+    template <typename WriterType> void Encode(WriterType& writer, const FileInfo& info) const
+    {
+        writer.WriteString(info.name);
+        writer.WriteString(info.GetExtension());
+        writer.WriteVarint(info.size);
+        writer.WriteVarint(static_cast<std::uint64_t>(info.type));
+
+        if (info.type == FileType::Directory) {
+            const auto& details = info.GetDirectoryDetails();
+            writer.WriteVarint(details.stamp.device);
+            writer.WriteVarint(details.stamp.inode);
+            writer.WriteVarint(static_cast<std::uint64_t>(details.stamp.modificationTime));
+            writer.WriteVarint(details.fileCount);
+        }
+    }
+
+    template <typename ReaderType> FileInfo Decode(ReaderType& reader) const
+    {
+        FileInfo info;
+        info.name = reader.ReadString();
+        info.extensionId = ExtensionDictionary::Shared().Intern(reader.ReadString());
+        info.size = static_cast<std::uintmax_t>(reader.ReadVarint());
+
+        const auto type = reader.ReadVarint();
+        if (type > static_cast<std::uint64_t>(FileType::Symlink)) {
+            reader.Fail();
+        }
+
+        info.type = static_cast<FileType>(type);
+
+        if (info.type == FileType::Directory) {
+            auto& details = info.EditDirectoryDetails();
+            details.stamp.device = reader.ReadVarint();
+            details.stamp.inode = reader.ReadVarint();
+            details.stamp.modificationTime = static_cast<std::int64_t>(reader.ReadVarint());
+            details.fileCount = static_cast<std::uintmax_t>(reader.ReadVarint());
+        }
+
+        return info;
+    }
+};
+
+/**
+ * @brief JSON codec for use with `TreeUtilities::WriteJson(...)` and
+ * `TreeUtilities::ReadJson(...)`.
+ */
+struct FileInfoJsonCodec
+{
+    template <typename WriterType> void Encode(WriterType& writer, const FileInfo& info) const
+    {
+        writer.BeginObject();
+        writer.Key("name");
+        writer.String(info.name);
+        writer.Key("extension");
+        writer.String(info.GetExtension());
+        writer.Key("size");
+        writer.Integer(info.size);
+        writer.Key("type");
+        writer.Integer(static_cast<unsigned int>(info.type));
+        writer.EndObject();
+    }
+
+    template <typename ReaderType> FileInfo Decode(ReaderType& reader) const
+    {
+        FileInfo info{};
+
+        std::string key;
+        std::string extension;
+        reader.BeginObject();
+
+        while (reader.NextKey(key)) {
+            if (key == "name") {
+                reader.ReadString(info.name);
+            } else if (key == "extension") {
+                reader.ReadString(extension);
+                info.extensionId = ExtensionDictionary::Shared().Intern(extension);
+            } else if (key == "size") {
+                info.size = reader.template ReadInteger<std::uintmax_t>();
+            } else if (key == "type") {
+                const auto type = reader.template ReadInteger<unsigned int>();
+                if (type > static_cast<unsigned int>(FileType::Symlink)) {
+                    reader.Fail();
+                }
+
+                info.type = static_cast<FileType>(type);
+            } else {
+                reader.SkipValue();
+            }
+        }
+
+        return info;
+    }
+};
+
+/**
+ * @brief The fixed-size portion of a FileInfo, as stored in a `TreeUtilities::MappedTree`. The
+ * file name, including its extension, is stored as the name of the mapped Node.
+ */
+struct MappedFileInfo
+{
+    std::uint64_t size;
+    std::uint32_t extensionLength;
+
+    FileType type;
+};
+
+/**
+ * @brief Codec for use with `TreeUtilities::SaveMapped(...)`.
+ */
+struct FileInfoMappedCodec
+{
+    std::string Name(const FileInfo& info) const
+    {
+        const auto extension = info.GetExtension();
+
+        std::string name;
+        name.reserve(info.name.size() + extension.size());
+        name.append(info.name).append(extension);
+
+        return name;
+    }
+
+    MappedFileInfo Payload(const FileInfo& info) const noexcept
+    {
+        return { info.size, static_cast<std::uint32_t>(info.GetExtension().size()), info.type };
+    }
 };
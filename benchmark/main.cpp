@@ -1,18 +1,27 @@
 #include <algorithm>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <numeric>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
 
+#include "mapped_tree.h"
 #include "tree.h"
+#include "tree_json.h"
+#include "tree_serialization.h"
 
 #include "drive_scanner.h"
+#include "drive_watcher.h"
 #include "scanning_progress.h"
+#include "string_pool.h"
 #include "stopwatch.h"
 
-#define BOOST_ASIO_DISABLE_CONCEPTS
-
 namespace
 {
 #if _DEBUG
@@ -38,22 +47,68 @@ template <typename ChronoType, typename LambdaType> auto RunTrials(LambdaType&&
     return sum / elapsedTimes.size();
 }
 
-void WaitAndReportProgress(const DriveScanner& scanner)
+void WaitAndReportProgress(DriveScanner& scanner)
 {
     const auto& scanningProgress = scanner.GetProgress();
+    const auto& root = *scanner.GetTree()->GetRoot();
 
     while (true) {
         if (scanningProgress.scanCompleted.load()) {
             return;
         }
 
-        std::cout << "File scanned: " << scanningProgress.filesScanned.load() << "\t\r"
-                  << std::flush;
+        // The top of the tree can be inspected while the scan is still in progress:
+        std::size_t directoryCount{ 0 };
+        std::size_t completedDirectoryCount{ 0 };
+
+        scanner.VisitChildren(root, [&](const Tree<FileInfo>::Node& child) {
+            if (child->type == FileType::Directory) {
+                ++directoryCount;
+                completedDirectoryCount += child->GetDirectoryDetails().isBeingScanned ? 0 : 1;
+            }
+        });
+
+        std::cout << "File scanned: " << scanningProgress.GetFilesScanned()
+                  << "\tTop-level directories completed: " << completedDirectoryCount << " of "
+                  << directoryCount << "\t\r" << std::flush;
 
         std::this_thread::sleep_for(std::chrono::seconds{ 1 });
     }
 }
 
+void ReportScanMetrics(const ScanMetrics& metrics)
+{
+    using ChronoType = std::chrono::microseconds;
+
+    const auto toMicroseconds = [](std::chrono::nanoseconds duration) {
+        return std::chrono::duration_cast<ChronoType>(duration).count();
+    };
+
+    std::cout << "Scanned " << metrics.filesScanned << " files in "
+              << toMicroseconds(metrics.elapsedTime) << " "
+              << detail::ChronoTypeName<ChronoType>::value << " ("
+              << static_cast<std::uintmax_t>(metrics.filesPerSecond) << " files/s, "
+              << static_cast<std::uintmax_t>(metrics.bytesPerSecond / (1024 * 1024)) << " MiB/s)."
+              << std::endl;
+
+    for (std::size_t index = 0; index < metrics.workers.size(); ++index) {
+        const auto& worker = metrics.workers[index];
+        std::cout << "Worker " << index << ": " << worker.taskCount << " tasks, busy for "
+                  << toMicroseconds(worker.busyTime) << ", idle for "
+                  << toMicroseconds(worker.idleTime) << " "
+                  << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
+    }
+
+    const auto reportLatency = [](std::string_view call, const LatencyHistogram& histogram) {
+        std::cout << "Latency of " << call << " (" << histogram.GetSampleCount()
+                  << " samples): p50 <= " << histogram.GetPercentile(50).count()
+                  << " ns, p99 <= " << histogram.GetPercentile(99).count() << " ns." << std::endl;
+    };
+
+    reportLatency("readdir", metrics.readdirLatency);
+    reportLatency("stat", metrics.statLatency);
+}
+
 void RunPreOrderTrial(Tree<FileInfo>& tree)
 {
     using ChronoType = std::chrono::milliseconds;
@@ -95,6 +150,345 @@ void RunPostOrderTrial(Tree<FileInfo>& tree)
     std::cout << "Average Post-Order Traversal Time: " << RunTrials<ChronoType>(postOrderTraversal)
               << " " << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
 }
+
+void RunSerializationTrial(const Tree<FileInfo>& tree)
+{
+    using ChronoType = std::chrono::milliseconds;
+
+    const auto path = std::filesystem::temp_directory_path() / "tree_benchmark.bin";
+
+    const auto saveClock = Stopwatch<ChronoType>([&] {
+        std::ofstream stream{ path, std::ios::binary };
+        TreeUtilities::Save(tree, stream, FileInfoCodec{});
+    });
+
+    std::cout << "Time to Save Tree: " << saveClock.GetElapsedTime().count() << " "
+              << detail::ChronoTypeName<ChronoType>::value << " ("
+              << std::filesystem::file_size(path) << " bytes)." << std::endl;
+
+    bool wasLoaded = false;
+
+    const auto loadClock = Stopwatch<ChronoType>([&] {
+        std::ifstream stream{ path, std::ios::binary };
+        wasLoaded = TreeUtilities::Load<FileInfo>(stream, FileInfoCodec{}).has_value();
+    });
+
+    if (!wasLoaded) {
+        std::cout << "Failed to load the saved tree." << std::endl;
+    }
+
+    std::cout << "Time to Load Tree: " << loadClock.GetElapsedTime().count() << " "
+              << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
+
+    std::filesystem::remove(path);
+}
+
+void RunJsonTrial(const Tree<FileInfo>& tree)
+{
+    using ChronoType = std::chrono::milliseconds;
+
+    const auto path = std::filesystem::temp_directory_path() / "tree_benchmark.ndjson";
+    const auto layout = TreeUtilities::JsonLayout::NewlineDelimited;
+
+    const auto writeClock = Stopwatch<ChronoType>([&] {
+        std::ofstream stream{ path, std::ios::binary };
+        TreeUtilities::WriteJson(tree, stream, layout, FileInfoJsonCodec{});
+    });
+
+    std::cout << "Time to Write JSON: " << writeClock.GetElapsedTime().count() << " "
+              << detail::ChronoTypeName<ChronoType>::value << " ("
+              << std::filesystem::file_size(path) << " bytes)." << std::endl;
+
+    bool wasRead = false;
+
+    const auto readClock = Stopwatch<ChronoType>([&] {
+        std::ifstream stream{ path, std::ios::binary };
+        wasRead =
+            TreeUtilities::ReadJson<FileInfo>(stream, layout, FileInfoJsonCodec{}).has_value();
+    });
+
+    if (!wasRead) {
+        std::cout << "Failed to read the written JSON." << std::endl;
+    }
+
+    std::cout << "Time to Read JSON: " << readClock.GetElapsedTime().count() << " "
+              << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
+
+    std::filesystem::remove(path);
+}
+
+/**
+ * @brief Rebuilds the specified tree, converting the data of every node along the way.
+ */
+template <typename TargetType, typename ConverterType>
+Tree<TargetType> ConvertTree(const Tree<FileInfo>& tree, ConverterType&& converter)
+{
+    Tree<TargetType> target{ converter(tree.GetRoot()->GetData()) };
+
+    std::vector<std::pair<const Tree<FileInfo>::Node*, typename Tree<TargetType>::Node*>> ancestors{
+        { tree.GetRoot(), target.GetRoot() }
+    };
+
+    std::for_each(
+        std::next(tree.beginPreOrder()), tree.endPreOrder(), [&](const Tree<FileInfo>::Node& node) {
+            while (ancestors.back().first != node.GetParent()) {
+                ancestors.pop_back();
+            }
+
+            auto* const copy = ancestors.back().second->AppendChild(converter(node.GetData()));
+            ancestors.emplace_back(&node, copy);
+        });
+
+    return target;
+}
+
+void RunStringPoolTrial(const Tree<FileInfo>& tree)
+{
+    using ChronoType = std::chrono::milliseconds;
+
+    std::optional<Tree<FileInfo>> ownedTree;
+
+    const auto ownedBuildClock = Stopwatch<ChronoType>([&] {
+        // Like the pooled variant, the copy leaves out the details that only directories have:
+        ownedTree = ConvertTree<FileInfo>(tree, [](const FileInfo& info) {
+            return FileInfo{ info.name, info.size, info.extensionId, info.type };
+        });
+    });
+
+    const auto ownedDestructionClock = Stopwatch<ChronoType>([&] { ownedTree.reset(); });
+
+    std::shared_ptr<Tree<PooledFileInfo>> pooledTree;
+
+    const auto pooledBuildClock = Stopwatch<ChronoType>([&] {
+        auto pool = std::make_shared<StringPool>();
+        auto arena = pool->CreateArena();
+
+        pooledTree = MakePooledTree(
+            ConvertTree<PooledFileInfo>(
+                tree,
+                [&](const FileInfo& info) {
+                    return PooledFileInfo{ arena.Store(info.name), info.size, info.extensionId,
+                                           info.type };
+                }),
+            std::move(pool));
+    });
+
+    const auto pooledDestructionClock = Stopwatch<ChronoType>([&] { pooledTree.reset(); });
+
+    std::cout << "Time to Build Tree with Owned Names: "
+              << ownedBuildClock.GetElapsedTime().count() << " "
+              << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
+
+    std::cout << "Time to Destroy Tree with Owned Names: "
+              << ownedDestructionClock.GetElapsedTime().count() << " "
+              << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
+
+    std::cout << "Time to Build Tree with Pooled Names: "
+              << pooledBuildClock.GetElapsedTime().count() << " "
+              << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
+
+    std::cout << "Time to Destroy Tree with Pooled Names: "
+              << pooledDestructionClock.GetElapsedTime().count() << " "
+              << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
+}
+
+void RunMappedTrial(const Tree<FileInfo>& tree)
+{
+    const auto path = std::filesystem::temp_directory_path() / "tree_benchmark.map";
+
+    {
+        std::ofstream stream{ path, std::ios::binary };
+        TreeUtilities::SaveMapped(tree, stream, FileInfoMappedCodec{});
+    }
+
+    std::optional<TreeUtilities::MappedTree<MappedFileInfo>> mappedTree;
+
+    const auto openClock = Stopwatch<std::chrono::microseconds>(
+        [&] { mappedTree = TreeUtilities::MappedTree<MappedFileInfo>::Open(path); });
+
+    if (!mappedTree) {
+        std::cout << "Failed to map the saved tree." << std::endl;
+        return;
+    }
+
+    std::cout << "Time to Map Tree: " << openClock.GetElapsedTime().count() << " "
+              << detail::ChronoTypeName<std::chrono::microseconds>::value << "." << std::endl;
+
+    using ChronoType = std::chrono::milliseconds;
+
+    const auto preOrderTraversal = [&]() noexcept {
+        std::uintmax_t totalBytes{ 0 };
+
+        std::for_each(
+            mappedTree->beginPreOrder(), mappedTree->endPreOrder(),
+            [&](const auto& node) noexcept {
+                if (node->type == FileType::Regular) {
+                    totalBytes += node->size;
+                }
+            });
+    };
+
+    std::cout << "Average Mapped Pre-Order Traversal Time: "
+              << RunTrials<ChronoType>(preOrderTraversal) << " "
+              << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
+
+    mappedTree.reset();
+    std::filesystem::remove(path);
+}
+
+void RunRescanTrial(DriveScanner& scanner)
+{
+    using ChronoType = std::chrono::milliseconds;
+
+    const auto clock = Stopwatch<ChronoType>([&] { scanner.Rescan(); });
+
+    std::cout << "Time to Rescan Drive: " << clock.GetElapsedTime().count() << " "
+              << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
+}
+
+/**
+ * @brief Attempts to evict the page, dentry, and inode caches, so that the next scan has to go to
+ * disk. This requires elevated privileges, and is silently skipped without them.
+ *
+ * @returns True if the caches were dropped.
+ */
+bool TryDropCaches()
+{
+#ifdef __linux__
+    std::ofstream stream{ "/proc/sys/vm/drop_caches" };
+    if (!stream) {
+        return false;
+    }
+
+    stream << "3" << std::flush;
+    return stream.good();
+#else // Linux
+    return false;
+#endif
+}
+
+void RunScanBackendTrial(const std::filesystem::path& root)
+{
+    using ChronoType = std::chrono::milliseconds;
+
+    const auto runScan = [&](std::string_view backend, bool useIoUring) {
+        const auto isCold = TryDropCaches();
+
+        ScanOptions options;
+        options.useIoUring = useIoUring;
+
+        DriveScanner scanner{ root, options };
+        const auto clock = Stopwatch<ChronoType>([&] { scanner.Start(); });
+
+        std::cout << "Time to Scan Drive (" << backend << ", " << (isCold ? "cold" : "warm")
+                  << " cache): " << clock.GetElapsedTime().count() << " "
+                  << detail::ChronoTypeName<ChronoType>::value << "." << std::endl;
+    };
+
+    runScan("fstatat", false);
+    runScan("io_uring", true);
+}
+
+#ifdef __linux__
+/**
+ * @returns The size and file count of every Node, keyed by its location, so that two trees of the
+ * same directory can be compared regardless of the order of their children.
+ */
+std::map<std::string, std::pair<std::uintmax_t, std::uintmax_t>>
+DescribeTree(const Tree<FileInfo>& tree)
+{
+    std::map<std::string, std::pair<std::uintmax_t, std::uintmax_t>> description;
+    std::string path;
+
+    std::for_each(tree.beginPreOrder(), tree.endPreOrder(), [&](const auto& node) {
+        const auto fileCount =
+            node->type == FileType::Directory ? node->GetDirectoryDetails().fileCount : 1;
+
+        DriveScanner::BuildPath(node, path);
+        description.emplace(path, std::make_pair(node->size, fileCount));
+    });
+
+    return description;
+}
+
+void RunWatcherTrial()
+{
+    namespace fs = std::filesystem;
+
+    const auto root = fs::temp_directory_path() / "drive_watcher_trial";
+    const auto outside = fs::temp_directory_path() / "drive_watcher_trial_outside";
+
+    std::error_code errorCode;
+    fs::remove_all(root, errorCode);
+    fs::remove_all(outside, errorCode);
+    fs::create_directories(root / "a" / "b", errorCode);
+    fs::create_directories(outside, errorCode);
+
+    const auto appendToFile = [](const fs::path& path, std::size_t size) {
+        std::ofstream stream{ path, std::ios::binary | std::ios::app };
+        stream << std::string(size, '-');
+    };
+
+    appendToFile(root / "a" / "first.txt", 16);
+    appendToFile(root / "a" / "b" / "second.bin", 32);
+
+    DriveScanner scanner{ root };
+    scanner.Start();
+
+    DriveWatcher watcher{ scanner };
+    if (!watcher.IsValid()) {
+        std::cout << "Drive Watcher Trial: skipped, since inotify is unavailable." << std::endl;
+        return;
+    }
+
+    std::size_t mismatchCount{ 0 };
+
+    // After each step, the watched tree should look exactly like a fresh scan of the directory:
+    const auto verifyStep = [&](std::string_view step) {
+        while (watcher.ProcessEvents(std::chrono::milliseconds{ 100 }) > 0) {
+        }
+
+        DriveScanner freshScanner{ root };
+        freshScanner.Start();
+
+        if (DescribeTree(*scanner.GetTree()) != DescribeTree(*freshScanner.GetTree())) {
+            std::cout << "Drive Watcher Trial: the watched tree differs from a fresh scan after "
+                      << step << "." << std::endl;
+
+            ++mismatchCount;
+        }
+    };
+
+    appendToFile(root / "third.txt", 8);
+    fs::create_directories(root / "c" / "d", errorCode);
+    appendToFile(root / "c" / "d" / "fourth.dat", 64);
+    verifyStep("creating entries");
+
+    appendToFile(root / "a" / "first.txt", 128);
+    verifyStep("modifying a file");
+
+    fs::rename(root / "a" / "b", root / "c" / "moved", errorCode);
+    fs::rename(root / "third.txt", root / "c" / "renamed.txt", errorCode);
+    verifyStep("renaming entries within the tree");
+
+    fs::rename(root / "c" / "d", outside / "d", errorCode);
+    fs::rename(root / "a" / "first.txt", outside / "first.txt", errorCode);
+    verifyStep("renaming entries out of the tree");
+
+    fs::rename(outside / "d", root / "returned", errorCode);
+    verifyStep("renaming a directory into the tree");
+
+    fs::remove_all(root / "c", errorCode);
+    fs::remove(root / "returned" / "fourth.dat", errorCode);
+    verifyStep("deleting entries");
+
+    std::cout << "Drive Watcher Trial: " << mismatchCount
+              << " mismatch(es) between the watched tree and a fresh scan." << std::endl;
+
+    fs::remove_all(root, errorCode);
+    fs::remove_all(outside, errorCode);
+}
+#endif // Linux
 } // namespace
 
 int main()
@@ -115,9 +509,21 @@ int main()
 
     std::cout << "\n\n";
 
+    ReportScanMetrics(scanner.GetMetrics());
+
     const auto tree = scanner.GetTree();
     RunPreOrderTrial(*tree);
     RunPostOrderTrial(*tree);
+    RunSerializationTrial(*tree);
+    RunJsonTrial(*tree);
+    RunMappedTrial(*tree);
+    RunStringPoolTrial(*tree);
+    RunRescanTrial(scanner);
+    RunScanBackendTrial(root);
+
+#ifdef __linux__
+    RunWatcherTrial();
+#endif // Linux
 
     return 0;
 }
@@ -0,0 +1,321 @@
+#include "metadata_ring.h"
+
+#ifdef HAS_IO_URING
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+namespace
+{
+unsigned int LoadAcquire(const unsigned int* value) noexcept
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+void StoreRelease(unsigned int* value, unsigned int newValue) noexcept
+{
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+void* MapRing(int descriptor, std::size_t size, off_t offset) noexcept
+{
+    void* const ring =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, offset);
+
+    return ring == MAP_FAILED ? nullptr : ring;
+}
+
+template <typename Type> Type* Offset(void* base, std::uint32_t offset) noexcept
+{
+    return reinterpret_cast<Type*>(static_cast<char*>(base) + offset);
+}
+} // namespace
+
+MetadataRing::~MetadataRing()
+{
+    if (m_submissionEntries) {
+        munmap(m_submissionEntries, m_submissionEntriesSize);
+    }
+
+    if (m_completionRing && m_completionRing != m_submissionRing) {
+        munmap(m_completionRing, m_completionRingSize);
+    }
+
+    if (m_submissionRing) {
+        munmap(m_submissionRing, m_submissionRingSize);
+    }
+
+    if (m_ringDescriptor >= 0) {
+        close(m_ringDescriptor);
+    }
+}
+
+MetadataRing* MetadataRing::GetForCurrentThread() noexcept
+{
+    thread_local const auto ring = []() -> std::unique_ptr<MetadataRing> {
+        std::unique_ptr<MetadataRing> candidate{ new (std::nothrow) MetadataRing{} };
+        if (!candidate || !candidate->Initialize()) {
+            return nullptr;
+        }
+
+        return candidate;
+    }();
+
+    return ring && !ring->m_hasFailed ? ring.get() : nullptr;
+}
+
+bool MetadataRing::Initialize() noexcept
+{
+    io_uring_params parameters;
+    std::memset(&parameters, 0, sizeof(parameters));
+
+    m_ringDescriptor =
+        static_cast<int>(syscall(__NR_io_uring_setup, QueueDepth, &parameters));
+
+    if (m_ringDescriptor < 0) {
+        return false;
+    }
+
+    m_submissionRingSize = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned int);
+    m_completionRingSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+
+    // Newer kernels allow both rings to share a single mapping:
+    const bool hasSingleMapping = parameters.features & IORING_FEAT_SINGLE_MMAP;
+    if (hasSingleMapping) {
+        m_submissionRingSize = std::max(m_submissionRingSize, m_completionRingSize);
+        m_completionRingSize = m_submissionRingSize;
+    }
+
+    m_submissionRing = MapRing(m_ringDescriptor, m_submissionRingSize, IORING_OFF_SQ_RING);
+    if (!m_submissionRing) {
+        return false;
+    }
+
+    m_completionRing = hasSingleMapping
+                           ? m_submissionRing
+                           : MapRing(m_ringDescriptor, m_completionRingSize, IORING_OFF_CQ_RING);
+
+    if (!m_completionRing) {
+        return false;
+    }
+
+    m_submissionEntriesSize = parameters.sq_entries * sizeof(io_uring_sqe);
+    m_submissionEntries = static_cast<io_uring_sqe*>(
+        MapRing(m_ringDescriptor, m_submissionEntriesSize, IORING_OFF_SQES));
+
+    if (!m_submissionEntries) {
+        return false;
+    }
+
+    m_submissionHead = Offset<unsigned int>(m_submissionRing, parameters.sq_off.head);
+    m_submissionTail = Offset<unsigned int>(m_submissionRing, parameters.sq_off.tail);
+    m_submissionMask = *Offset<unsigned int>(m_submissionRing, parameters.sq_off.ring_mask);
+    m_submissionArray = Offset<unsigned int>(m_submissionRing, parameters.sq_off.array);
+
+    m_completionHead = Offset<unsigned int>(m_completionRing, parameters.cq_off.head);
+    m_completionTail = Offset<unsigned int>(m_completionRing, parameters.cq_off.tail);
+    m_completionMask = *Offset<unsigned int>(m_completionRing, parameters.cq_off.ring_mask);
+    m_completionEntries = Offset<io_uring_cqe>(m_completionRing, parameters.cq_off.cqes);
+
+    m_results.resize(parameters.sq_entries);
+    m_slotToEntry.resize(parameters.sq_entries);
+    m_freeSlots.reserve(parameters.sq_entries);
+
+    return true;
+}
+
+io_uring_sqe* MetadataRing::GetSubmissionEntry() noexcept
+{
+    // Only this thread ever writes the tail, so it can be read without synchronization:
+    const auto tail = *m_submissionTail;
+    const auto index = tail & m_submissionMask;
+
+    auto* const entry = &m_submissionEntries[index];
+    std::memset(entry, 0, sizeof(*entry));
+
+    m_submissionArray[index] = index;
+    StoreRelease(m_submissionTail, tail + 1);
+
+    return entry;
+}
+
+bool MetadataRing::Submit(unsigned int& unsubmittedCount, unsigned int pendingCount) noexcept
+{
+    while (true) {
+        const auto result = syscall(
+            __NR_io_uring_enter, m_ringDescriptor, unsubmittedCount, 1, IORING_ENTER_GETEVENTS,
+            nullptr, 0);
+
+        if (result > 0 || (result == 0 && unsubmittedCount == 0)) {
+            // The kernel may accept fewer entries than were queued, in which case it returns
+            // without waiting. The rest is then submitted once whatever completed was reaped:
+            unsubmittedCount -= std::min(static_cast<unsigned int>(result), unsubmittedCount);
+            return true;
+        }
+
+        if (result == 0) {
+            return false;
+        }
+
+        // A full completion queue, or a lack of resources, only clears up once completions have
+        // been reaped, so retrying right away could spin indefinitely. If nothing is pending, then
+        // nothing will ever complete, and the caller is better off without the ring:
+        if (errno == EAGAIN || errno == EBUSY) {
+            return pendingCount > 0 && WaitForCompletion();
+        }
+
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+bool MetadataRing::WaitForCompletion() noexcept
+{
+    while (true) {
+        const auto result = syscall(
+            __NR_io_uring_enter, m_ringDescriptor, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+        if (result >= 0) {
+            return true;
+        }
+
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+void MetadataRing::Drain(unsigned int submittedCount) noexcept
+{
+    while (submittedCount > 0) {
+        const auto head = *m_completionHead;
+        const auto tail = LoadAcquire(m_completionTail);
+
+        if (head == tail) {
+            // Even if waiting fails, the kernel still posts completions to the shared ring:
+            if (syscall(
+                    __NR_io_uring_enter, m_ringDescriptor, 0, 1, IORING_ENTER_GETEVENTS, nullptr,
+                    0) < 0) {
+                sched_yield();
+            }
+
+            continue;
+        }
+
+        submittedCount -= std::min(tail - head, submittedCount);
+        StoreRelease(m_completionHead, tail);
+    }
+}
+
+bool MetadataRing::ResolveMetadata(
+    int directoryDescriptor, std::vector<DirectoryEntry>& entries) noexcept
+{
+    if (m_hasFailed) {
+        return false;
+    }
+
+    // Each request is tagged with a slot in the result buffer, which is returned to the free-list
+    // once the request has completed:
+    m_freeSlots.clear();
+    for (auto slot = static_cast<unsigned int>(m_results.size()); slot > 0; --slot) {
+        m_freeSlots.push_back(slot - 1);
+    }
+
+    std::size_t nextEntry{ 0 };
+
+    // Requests without a completion, of which the first |inFlight - unsubmitted| were accepted by
+    // the kernel, while the rest are still waiting in the submission queue:
+    unsigned int inFlight{ 0 };
+    unsigned int unsubmitted{ 0 };
+
+    while (true) {
+        for (; nextEntry < entries.size() && !m_freeSlots.empty(); ++nextEntry) {
+            if (!entries[nextEntry].NeedsMetadata()) {
+                continue;
+            }
+
+            const auto slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+            m_slotToEntry[slot] = nextEntry;
+
+            auto* const request = GetSubmissionEntry();
+            request->opcode = IORING_OP_STATX;
+            request->fd = directoryDescriptor;
+            request->addr = reinterpret_cast<std::uint64_t>(entries[nextEntry].name.data());
+            request->len = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_INO | STATX_NLINK;
+            request->off = reinterpret_cast<std::uint64_t>(&m_results[slot]);
+            request->statx_flags = AT_SYMLINK_NOFOLLOW;
+            request->user_data = slot;
+
+            ++inFlight;
+            ++unsubmitted;
+        }
+
+        if (inFlight == 0) {
+            return true;
+        }
+
+        if (!Submit(unsubmitted, inFlight - unsubmitted)) {
+            // The requests that the kernel did accept still refer to the names of the entries, and
+            // to the result buffers, so they have to complete before the caller can resolve the
+            // entries synchronously. The ring can't be reused, since the requests that it didn't
+            // accept are still queued:
+            Drain(inFlight - unsubmitted);
+
+            m_hasFailed = true;
+            return false;
+        }
+
+        auto head = *m_completionHead;
+        const auto tail = LoadAcquire(m_completionTail);
+
+        for (; head != tail; ++head) {
+            const auto& completion = m_completionEntries[head & m_completionMask];
+            const auto slot = static_cast<unsigned int>(completion.user_data);
+
+            auto& entry = entries[m_slotToEntry[slot]];
+            if (completion.res < 0) {
+                // Older kernels don't support asynchronous `statx`, so use a synchronous call:
+                struct stat status;
+                if (fstatat(directoryDescriptor, entry.name.data(), &status, AT_SYMLINK_NOFOLLOW)) {
+                    entry.type = EntryType::Other;
+                } else {
+                    DirectoryReader::SetMetadata(
+                        entry, status.st_mode, static_cast<std::uintmax_t>(status.st_size),
+                        FileIdentity{ static_cast<std::uint64_t>(status.st_dev),
+                                      static_cast<std::uint64_t>(status.st_ino) },
+                        static_cast<std::uint64_t>(status.st_nlink));
+                }
+            } else {
+                const auto& result = m_results[slot];
+                const auto device = makedev(result.stx_dev_major, result.stx_dev_minor);
+
+                DirectoryReader::SetMetadata(
+                    entry, result.stx_mode, static_cast<std::uintmax_t>(result.stx_size),
+                    FileIdentity{ static_cast<std::uint64_t>(device), result.stx_ino },
+                    result.stx_nlink);
+            }
+
+            m_freeSlots.push_back(slot);
+            --inFlight;
+        }
+
+        StoreRelease(m_completionHead, head);
+    }
+}
+
+#endif // HAS_IO_URING
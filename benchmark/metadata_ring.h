@@ -0,0 +1,120 @@
+#pragma once
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAS_IO_URING 1
+#endif
+
+#ifdef HAS_IO_URING
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "directory_reader.h"
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+struct statx;
+
+/**
+ * @brief Retrieves the metadata of many directory entries at once, using io_uring.
+ *
+ * Rather than blocking on one `fstatat` call after another, a `statx` request is queued for every
+ * entry that needs one, so that a single thread can keep a deep queue of metadata requests in
+ * flight. This matters most on cold caches, where each request may need to go to disk.
+ *
+ * Rings aren't thread-safe, so every thread uses its own, which is created on first use.
+ *
+ * @note This talks to the kernel directly, since liburing isn't necessarily available.
+ */
+class MetadataRing
+{
+  public:
+    static constexpr unsigned int QueueDepth{ 256 };
+
+    ~MetadataRing();
+
+    MetadataRing(const MetadataRing&) = delete;
+    MetadataRing& operator=(const MetadataRing&) = delete;
+
+    /**
+     * @returns The ring of the calling thread, or nullptr if io_uring isn't available, in which
+     * case callers should fall back to DirectoryReader::ResolveMetadata(...).
+     */
+    static MetadataRing* GetForCurrentThread() noexcept;
+
+    /**
+     * @brief Retrieves the metadata of every entry that needs it. Entries that cannot be stat'ed
+     * are marked as EntryType::Other.
+     *
+     * @param[in] directoryDescriptor The descriptor of the directory that contains the entries.
+     * @param[in, out] entries        The entries to resolve.
+     *
+     * @returns False if the ring failed, in which case the entries need to be resolved
+     * synchronously instead.
+     */
+    bool ResolveMetadata(int directoryDescriptor, std::vector<DirectoryEntry>& entries) noexcept;
+
+  private:
+    MetadataRing() noexcept = default;
+
+    bool Initialize() noexcept;
+
+    io_uring_sqe* GetSubmissionEntry() noexcept;
+
+    /**
+     * @brief Submits queued requests, and waits for at least one completion if the kernel accepted
+     * all of them.
+     *
+     * @param[in, out] unsubmittedCount The number of queued requests that the kernel has yet to
+     *                                  accept, which is reduced by the number that it accepted.
+     * @param[in] pendingCount          The number of previously accepted requests that have yet to
+     *                                  complete.
+     *
+     * @returns False if the ring failed, or if it can't make progress.
+     */
+    bool Submit(unsigned int& unsubmittedCount, unsigned int pendingCount) noexcept;
+
+    /**
+     * @brief Blocks until at least one accepted request has completed.
+     *
+     * @returns False if waiting failed.
+     */
+    bool WaitForCompletion() noexcept;
+
+    /**
+     * @brief Waits for the specified number of accepted requests to complete, discarding their
+     * results.
+     */
+    void Drain(unsigned int submittedCount) noexcept;
+
+    int m_ringDescriptor{ -1 };
+
+    void* m_submissionRing{ nullptr };
+    std::size_t m_submissionRingSize{ 0 };
+
+    void* m_completionRing{ nullptr };
+    std::size_t m_completionRingSize{ 0 };
+
+    io_uring_sqe* m_submissionEntries{ nullptr };
+    std::size_t m_submissionEntriesSize{ 0 };
+
+    unsigned int* m_submissionHead{ nullptr };
+    unsigned int* m_submissionTail{ nullptr };
+    unsigned int m_submissionMask{ 0 };
+    unsigned int* m_submissionArray{ nullptr };
+
+    unsigned int* m_completionHead{ nullptr };
+    unsigned int* m_completionTail{ nullptr };
+    unsigned int m_completionMask{ 0 };
+    io_uring_cqe* m_completionEntries{ nullptr };
+
+    // One result buffer per request that can be in flight at once:
+    std::vector<struct statx> m_results;
+    std::vector<std::size_t> m_slotToEntry;
+    std::vector<unsigned int> m_freeSlots;
+
+    bool m_hasFailed{ false };
+};
+
+#endif // HAS_IO_URING
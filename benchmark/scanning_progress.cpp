@@ -0,0 +1,187 @@
+#include "scanning_progress.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+std::int64_t GetCurrentTime() noexcept
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+} // namespace
+
+std::size_t LatencyHistogram::GetBucket(std::chrono::nanoseconds latency) noexcept
+{
+    auto value = static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0));
+
+    std::size_t bucket{ 0 };
+    while (value > 0 && bucket < BucketCount - 1) {
+        value >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+std::uint64_t LatencyHistogram::GetSampleCount() const noexcept
+{
+    std::uint64_t count{ 0 };
+    for (const auto bucket : buckets) {
+        count += bucket;
+    }
+
+    return count;
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetPercentile(double percentile) const noexcept
+{
+    const auto sampleCount = GetSampleCount();
+    if (sampleCount == 0) {
+        return std::chrono::nanoseconds{ 0 };
+    }
+
+    const auto rank = static_cast<std::uint64_t>(
+        std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(sampleCount)));
+
+    std::uint64_t count{ 0 };
+    for (std::size_t bucket = 0; bucket < BucketCount; ++bucket) {
+        count += buckets[bucket];
+        if (count >= std::max<std::uint64_t>(rank, 1)) {
+            return std::chrono::nanoseconds{ std::int64_t{ 1 } << bucket };
+        }
+    }
+
+    return std::chrono::nanoseconds{ std::int64_t{ 1 } << (BucketCount - 1) };
+}
+
+void ScanningProgress::Reset() noexcept
+{
+    for (auto& shard : m_shards) {
+        shard.filesScanned.store(0);
+        shard.directoriesScanned.store(0);
+        shard.bytesProcessed.store(0);
+
+        for (auto& bucket : shard.readdirLatency) {
+            bucket.store(0);
+        }
+
+        for (auto& bucket : shard.statLatency) {
+            bucket.store(0);
+        }
+    }
+
+    m_startTime.store(GetCurrentTime());
+    m_endTime.store(0);
+    scanCompleted.store(false);
+}
+
+void ScanningProgress::MarkCompleted() noexcept
+{
+    m_endTime.store(GetCurrentTime());
+    scanCompleted.store(true);
+}
+
+void ScanningProgress::RecordFile(std::uintmax_t size) noexcept
+{
+    auto& shard = GetShard();
+    shard.filesScanned.fetch_add(1, std::memory_order_relaxed);
+
+    if (size > 0) {
+        shard.bytesProcessed.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+void ScanningProgress::RecordDirectory() noexcept
+{
+    GetShard().directoriesScanned.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ScanningProgress::RecordReaddirLatency(std::chrono::nanoseconds latency) noexcept
+{
+    const auto bucket = LatencyHistogram::GetBucket(latency);
+    GetShard().readdirLatency[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void ScanningProgress::RecordStatLatency(
+    std::chrono::nanoseconds latency, std::uint64_t entryCount) noexcept
+{
+    if (entryCount == 0) {
+        return;
+    }
+
+    const auto bucket = LatencyHistogram::GetBucket(latency / entryCount);
+    GetShard().statLatency[bucket].fetch_add(entryCount, std::memory_order_relaxed);
+}
+
+std::uintmax_t ScanningProgress::GetFilesScanned() const noexcept
+{
+    std::uintmax_t sum{ 0 };
+    for (const auto& shard : m_shards) {
+        sum += shard.filesScanned.load(std::memory_order_relaxed);
+    }
+
+    return sum;
+}
+
+std::uintmax_t ScanningProgress::GetDirectoriesScanned() const noexcept
+{
+    std::uintmax_t sum{ 0 };
+    for (const auto& shard : m_shards) {
+        sum += shard.directoriesScanned.load(std::memory_order_relaxed);
+    }
+
+    return sum;
+}
+
+std::uintmax_t ScanningProgress::GetBytesProcessed() const noexcept
+{
+    std::uintmax_t sum{ 0 };
+    for (const auto& shard : m_shards) {
+        sum += shard.bytesProcessed.load(std::memory_order_relaxed);
+    }
+
+    return sum;
+}
+
+ScanMetrics ScanningProgress::TakeSnapshot() const
+{
+    ScanMetrics metrics{};
+    metrics.filesScanned = GetFilesScanned();
+    metrics.directoriesScanned = GetDirectoriesScanned();
+    metrics.bytesProcessed = GetBytesProcessed();
+    metrics.scanCompleted = scanCompleted.load();
+
+    const auto endTime = m_endTime.load();
+    const auto currentTime = endTime != 0 ? endTime : GetCurrentTime();
+    metrics.elapsedTime = std::chrono::nanoseconds{ currentTime - m_startTime.load() };
+
+    const auto seconds = std::chrono::duration<double>{ metrics.elapsedTime }.count();
+    if (seconds > 0.0) {
+        metrics.filesPerSecond = static_cast<double>(metrics.filesScanned) / seconds;
+        metrics.bytesPerSecond = static_cast<double>(metrics.bytesProcessed) / seconds;
+    }
+
+    for (const auto& shard : m_shards) {
+        for (std::size_t bucket = 0; bucket < LatencyHistogram::BucketCount; ++bucket) {
+            metrics.readdirLatency.buckets[bucket] +=
+                shard.readdirLatency[bucket].load(std::memory_order_relaxed);
+
+            metrics.statLatency.buckets[bucket] +=
+                shard.statLatency[bucket].load(std::memory_order_relaxed);
+        }
+    }
+
+    return metrics;
+}
+
+ScanningProgress::Shard& ScanningProgress::GetShard() noexcept
+{
+    // Threads are assigned shards in a round-robin fashion, the first time that they record
+    // anything. With no more threads than shards, no two threads share a shard:
+    static std::atomic<std::size_t> nextShard{ 0 };
+    thread_local const std::size_t shard = nextShard.fetch_add(1) % ShardCount;
+
+    return m_shards[shard];
+}
@@ -1,27 +1,165 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <vector>
+
+#include "task_scheduler.h"
+
+/**
+ * @brief A histogram of latencies, whose buckets double in width.
+ */
+struct LatencyHistogram
+{
+    // Bucket |n| counts the samples that took at least 2^(n - 1), but less than 2^n nanoseconds.
+    // The last bucket also counts every sample that took longer than that:
+    static constexpr std::size_t BucketCount{ 32 };
+
+    /**
+     * @returns The bucket that the specified latency falls into.
+     */
+    static std::size_t GetBucket(std::chrono::nanoseconds latency) noexcept;
+
+    /**
+     * @returns The number of samples in the histogram.
+     */
+    std::uint64_t GetSampleCount() const noexcept;
+
+    /**
+     * @brief Estimates a percentile of the recorded latencies.
+     *
+     * @param[in] percentile          The percentile to estimate, between 0 and 100.
+     *
+     * @returns The upper bound of the bucket that the percentile falls into, or zero if the
+     * histogram is empty.
+     */
+    std::chrono::nanoseconds GetPercentile(double percentile) const noexcept;
+
+    std::array<std::uint64_t, BucketCount> buckets{};
+};
+
+/**
+ * @brief A point-in-time view of a scan, as assembled by `DriveScanner::GetMetrics()`.
+ */
+struct ScanMetrics
+{
+    std::uintmax_t filesScanned;
+    std::uintmax_t directoriesScanned;
+    std::uintmax_t bytesProcessed;
+
+    bool scanCompleted;
+
+    // The time since the scan started, or the duration of the scan, once it has completed:
+    std::chrono::nanoseconds elapsedTime;
+
+    double filesPerSecond;
+    double bytesPerSecond;
+
+    // The number of directories that have been discovered, but that no worker has picked up yet:
+    std::size_t queuedTaskCount;
+
+    std::vector<WorkerStatistics> workers;
+
+    // The latency of reading a single batch of directory entries:
+    LatencyHistogram readdirLatency;
+
+    // The latency of retrieving the metadata of a single entry. Since metadata is retrieved in
+    // batches, each sample is the average latency of the batch that the entry was part of:
+    LatencyHistogram statLatency;
+};
 
 /**
  * @brief Various pieces of metadata to track file system scan progress.
+ *
+ * Every thread that records progress is assigned one of several shards, each of which lives on
+ * its own cache line, so that threads don't contend for the same counters. The shards are only
+ * summed up when the progress is read, which is far less frequent.
  */
 class ScanningProgress
 {
   public:
     /**
-     * @brief Resets the scanning progress metadata.
+     * @brief Resets the scanning progress metadata, and marks the start of a new scan.
+     *
+     * @note Shouldn't be called while progress is being recorded.
+     */
+    void Reset() noexcept;
+
+    /**
+     * @brief Marks the end of the scan.
      */
-    void Reset() noexcept
+    void MarkCompleted() noexcept;
+
+    /**
+     * @brief Records that a file was scanned.
+     *
+     * @param[in] size                The size of the file, in bytes.
+     */
+    void RecordFile(std::uintmax_t size) noexcept;
+
+    /**
+     * @brief Records that a directory was scanned.
+     */
+    void RecordDirectory() noexcept;
+
+    /**
+     * @brief Records how long it took to read a batch of directory entries.
+     */
+    void RecordReaddirLatency(std::chrono::nanoseconds latency) noexcept;
+
+    /**
+     * @brief Records how long it took to retrieve the metadata of a batch of entries.
+     *
+     * @param[in] latency             The time it took to process the entire batch.
+     * @param[in] entryCount          The number of entries whose metadata was retrieved.
+     */
+    void RecordStatLatency(std::chrono::nanoseconds latency, std::uint64_t entryCount) noexcept;
+
+    /**
+     * @returns The number of files scanned so far.
+     */
+    std::uintmax_t GetFilesScanned() const noexcept;
+
+    /**
+     * @returns The number of directories scanned so far.
+     */
+    std::uintmax_t GetDirectoriesScanned() const noexcept;
+
+    /**
+     * @returns The combined size of the files scanned so far, in bytes.
+     */
+    std::uintmax_t GetBytesProcessed() const noexcept;
+
+    /**
+     * @returns The current progress, along with the rates and latencies derived from it. The
+     * fields that only the TaskScheduler knows about are left empty.
+     */
+    ScanMetrics TakeSnapshot() const;
+
+    std::atomic<bool> scanCompleted{ false };
+
+  private:
+    struct alignas(64) Shard
     {
-        filesScanned.store(0);
-        directoriesScanned.store(0);
-        bytesProcessed.store(0);
-        scanCompleted.store(false);
-    }
-
-    std::atomic<std::uintmax_t> filesScanned;
-    std::atomic<std::uintmax_t> directoriesScanned;
-    std::atomic<std::uintmax_t> bytesProcessed;
-    std::atomic<bool> scanCompleted;
+        std::atomic<std::uintmax_t> filesScanned{ 0 };
+        std::atomic<std::uintmax_t> directoriesScanned{ 0 };
+        std::atomic<std::uintmax_t> bytesProcessed{ 0 };
+
+        std::array<std::atomic<std::uint64_t>, LatencyHistogram::BucketCount> readdirLatency{};
+        std::array<std::atomic<std::uint64_t>, LatencyHistogram::BucketCount> statLatency{};
+    };
+
+    static constexpr std::size_t ShardCount{ 32 };
+
+    Shard& GetShard() noexcept;
+
+    std::array<Shard, ShardCount> m_shards;
+
+    // In nanoseconds since the epoch of `std::chrono::steady_clock`. The end time is zero while
+    // the scan is still running:
+    std::atomic<std::int64_t> m_startTime{ 0 };
+    std::atomic<std::int64_t> m_endTime{ 0 };
 };
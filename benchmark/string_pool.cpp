@@ -0,0 +1,83 @@
+#include "string_pool.h"
+
+#include <cstring>
+
+StringPool::Arena::Arena(StringPool& pool) noexcept : m_pool{ &pool }
+{
+}
+
+StringPool::Arena::Arena(Arena&& other) noexcept
+    : m_pool{ other.m_pool },
+      m_cursor{ std::exchange(other.m_cursor, nullptr) },
+      m_remainingSize{ std::exchange(other.m_remainingSize, 0) }
+{
+}
+
+StringPool::Arena& StringPool::Arena::operator=(Arena&& other) noexcept
+{
+    if (this != &other) {
+        m_pool = other.m_pool;
+        m_cursor = std::exchange(other.m_cursor, nullptr);
+        m_remainingSize = std::exchange(other.m_remainingSize, 0);
+    }
+
+    return *this;
+}
+
+std::string_view StringPool::Arena::Store(std::string_view value)
+{
+    if (value.empty()) {
+        return {};
+    }
+
+    if (value.size() > m_remainingSize) {
+        // Strings that would waste a sizable part of a fresh block get a block of their own, so
+        // that the current block can still be filled up:
+        if (value.size() > m_pool->m_blockSize / 4) {
+            auto* const block = m_pool->AllocateBlock(value.size());
+            std::memcpy(block, value.data(), value.size());
+
+            return { block, value.size() };
+        }
+
+        m_cursor = m_pool->AllocateBlock(m_pool->m_blockSize);
+        m_remainingSize = m_pool->m_blockSize;
+    }
+
+    auto* const copy = m_cursor;
+    std::memcpy(copy, value.data(), value.size());
+
+    m_cursor += value.size();
+    m_remainingSize -= value.size();
+
+    return { copy, value.size() };
+}
+
+StringPool::StringPool(std::size_t blockSize) : m_blockSize{ blockSize }
+{
+}
+
+StringPool::Arena StringPool::CreateArena() noexcept
+{
+    return Arena{ *this };
+}
+
+std::size_t StringPool::GetAllocatedSize() const
+{
+    const std::lock_guard<decltype(m_mutex)> lock{ m_mutex };
+    return m_allocatedSize;
+}
+
+char* StringPool::AllocateBlock(std::size_t size)
+{
+    // Allocate outside of the lock, so that other threads only wait for the bookkeeping. Unlike
+    // `std::make_unique<char[]>(...)`, this also skips zeroing the block:
+    std::unique_ptr<char[]> block{ new char[size] };
+    auto* const data = block.get();
+
+    const std::lock_guard<decltype(m_mutex)> lock{ m_mutex };
+    m_blocks.emplace_back(std::move(block));
+    m_allocatedSize += size;
+
+    return data;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tree.h"
+
+/**
+ * @brief An append-only pool of strings, backed by large blocks of memory.
+ *
+ * Strings are copied into the pool through an Arena, which hands out views into the pool's
+ * blocks. Each thread should use its own Arena, so that storing a string only requires bumping a
+ * pointer; the pool's lock is only taken whenever an Arena needs a new block. All strings are
+ * released at once when the pool is destroyed, so the pool needs to outlive every view into it.
+ */
+class StringPool
+{
+  public:
+    static constexpr std::size_t DefaultBlockSize{ 256 * 1024 };
+
+    /**
+     * @brief Copies strings into the pool on behalf of a single thread.
+     */
+    class Arena
+    {
+      public:
+        // Copies would hand out the same bytes, and so overwrite each other's strings:
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        /**
+         * @brief Takes over the remainder of the other Arena's current block. The other Arena
+         * remains usable, and will start a new block the next time it stores a string.
+         */
+        Arena(Arena&& other) noexcept;
+
+        /**
+         * @overload
+         */
+        Arena& operator=(Arena&& other) noexcept;
+
+        /**
+         * @brief Copies the specified string into the pool.
+         *
+         * @returns A view of the copy, which remains valid for the lifetime of the pool.
+         */
+        std::string_view Store(std::string_view value);
+
+      private:
+        friend class StringPool;
+
+        explicit Arena(StringPool& pool) noexcept;
+
+        StringPool* m_pool;
+
+        char* m_cursor{ nullptr };
+        std::size_t m_remainingSize{ 0 };
+    };
+
+    explicit StringPool(std::size_t blockSize = DefaultBlockSize);
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    /**
+     * @returns A new Arena that stores strings in this pool.
+     */
+    Arena CreateArena() noexcept;
+
+    /**
+     * @returns The total number of bytes that the pool has allocated.
+     */
+    std::size_t GetAllocatedSize() const;
+
+  private:
+    char* AllocateBlock(std::size_t size);
+
+    const std::size_t m_blockSize;
+
+    mutable std::mutex m_mutex;
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    std::size_t m_allocatedSize{ 0 };
+};
+
+/**
+ * @brief Moves a tree whose data refers to strings in the specified pool into shared ownership,
+ * such that the pool is kept alive until the tree has been destroyed.
+ */
+template <typename DataType>
+std::shared_ptr<Tree<DataType>>
+MakePooledTree(Tree<DataType>&& tree, std::shared_ptr<const StringPool> pool)
+{
+    const auto deleter = [pool = std::move(pool)](Tree<DataType>* pooledTree) noexcept {
+        delete pooledTree;
+    };
+
+    return std::shared_ptr<Tree<DataType>>{ new Tree<DataType>{ std::move(tree) }, deleter };
+}
@@ -0,0 +1,210 @@
+#include "task_scheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace
+{
+// Identifies the worker that the calling thread belongs to, if any:
+thread_local const TaskScheduler* currentScheduler{ nullptr };
+thread_local std::size_t currentWorkerIndex{ 0 };
+
+std::int64_t GetCurrentTime() noexcept
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+} // namespace
+
+TaskScheduler::TaskScheduler(unsigned int threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    m_queues.reserve(threadCount);
+    for (unsigned int index = 0; index < threadCount; ++index) {
+        m_queues.emplace_back(std::make_unique<WorkerQueue>());
+    }
+
+    m_statisticsResetTime.store(GetCurrentTime());
+
+    m_threads.reserve(threadCount);
+    for (std::size_t index = 0; index < threadCount; ++index) {
+        m_threads.emplace_back([this, index] { RunWorker(index); });
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        const std::lock_guard<decltype(m_mutex)> lock{ m_mutex };
+        m_isStopping.store(true);
+    }
+
+    m_workAvailable.notify_all();
+
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void TaskScheduler::Post(Task task)
+{
+    m_pendingTaskCount.fetch_add(1);
+
+    if (currentScheduler == this) {
+        Push(currentWorkerIndex, std::move(task));
+    } else {
+        Push(m_nextQueue.fetch_add(1) % m_queues.size(), std::move(task));
+    }
+}
+
+void TaskScheduler::Wait()
+{
+    assert(currentScheduler != this && "Waiting from within a task would never finish.");
+
+    std::unique_lock<decltype(m_mutex)> lock{ m_mutex };
+    m_allTasksFinished.wait(lock, [&] { return m_pendingTaskCount.load() == 0; });
+}
+
+std::size_t TaskScheduler::GetThreadCount() const noexcept
+{
+    return m_threads.size();
+}
+
+std::size_t TaskScheduler::GetQueuedTaskCount() const noexcept
+{
+    return m_queuedTaskCount.load();
+}
+
+std::vector<WorkerStatistics> TaskScheduler::GetWorkerStatistics() const
+{
+    std::vector<WorkerStatistics> statistics;
+    statistics.reserve(m_queues.size());
+
+    for (const auto& queue : m_queues) {
+        statistics.push_back({ std::chrono::nanoseconds{ queue->busyTime.load() },
+                               std::chrono::nanoseconds{ queue->idleTime.load() },
+                               queue->taskCount.load() });
+    }
+
+    return statistics;
+}
+
+void TaskScheduler::ResetStatistics() noexcept
+{
+    m_statisticsResetTime.store(GetCurrentTime());
+
+    for (auto& queue : m_queues) {
+        queue->busyTime.store(0);
+        queue->idleTime.store(0);
+        queue->taskCount.store(0);
+    }
+}
+
+void TaskScheduler::RunWorker(std::size_t index)
+{
+    currentScheduler = this;
+    currentWorkerIndex = index;
+
+    auto& statistics = *m_queues[index];
+
+    Task task;
+
+    while (!m_isStopping.load()) {
+        if (TryPopLocal(index, task) || TrySteal(index, task)) {
+            const auto startTime = GetCurrentTime();
+            task();
+
+            statistics.busyTime.fetch_add(GetCurrentTime() - startTime);
+            statistics.taskCount.fetch_add(1);
+
+            // Destroying the task first ensures that nothing it captured outlives the wait:
+            task = nullptr;
+
+            if (m_pendingTaskCount.fetch_sub(1) == 1) {
+                const std::lock_guard<decltype(m_mutex)> lock{ m_mutex };
+                m_allTasksFinished.notify_all();
+            }
+
+            continue;
+        }
+
+        std::unique_lock<decltype(m_mutex)> lock{ m_mutex };
+
+        // Since this is incremented before the queues are checked once more, and Push(...)
+        // increments the queued task count before checking for sleeping workers, either this
+        // worker sees the new task, or the poster sees this worker and wakes it up:
+        m_sleepingWorkerCount.fetch_add(1);
+
+        const auto sleepTime = GetCurrentTime();
+        m_workAvailable.wait(
+            lock, [&] { return m_isStopping.load() || m_queuedTaskCount.load() > 0; });
+
+        const auto idleTime =
+            GetCurrentTime() - std::max(sleepTime, m_statisticsResetTime.load());
+
+        statistics.idleTime.fetch_add(std::max(idleTime, std::int64_t{ 0 }));
+        m_sleepingWorkerCount.fetch_sub(1);
+    }
+}
+
+bool TaskScheduler::TryPopLocal(std::size_t index, Task& task)
+{
+    auto& queue = *m_queues[index];
+
+    const std::lock_guard<decltype(queue.mutex)> lock{ queue.mutex };
+    if (queue.tasks.empty()) {
+        return false;
+    }
+
+    // Taking the most recently posted task keeps the traversal depth-first:
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+
+    m_queuedTaskCount.fetch_sub(1);
+    return true;
+}
+
+bool TaskScheduler::TrySteal(std::size_t index, Task& task)
+{
+    for (std::size_t offset = 1; offset < m_queues.size(); ++offset) {
+        auto& queue = *m_queues[(index + offset) % m_queues.size()];
+
+        const std::lock_guard<decltype(queue.mutex)> lock{ queue.mutex };
+        if (queue.tasks.empty()) {
+            continue;
+        }
+
+        // The oldest task is closest to the root of the work that it belongs to, so stealing it
+        // is likely to yield the most work in return:
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+
+        m_queuedTaskCount.fetch_sub(1);
+        return true;
+    }
+
+    return false;
+}
+
+void TaskScheduler::Push(std::size_t index, Task task)
+{
+    auto& queue = *m_queues[index];
+
+    {
+        const std::lock_guard<decltype(queue.mutex)> lock{ queue.mutex };
+        queue.tasks.push_back(std::move(task));
+
+        // Counting the task before the queue is unlocked ensures that it's counted before any
+        // other worker can pop it, which would otherwise briefly wrap the count around:
+        m_queuedTaskCount.fetch_add(1);
+    }
+
+    if (m_sleepingWorkerCount.load() > 0) {
+        const std::lock_guard<decltype(m_mutex)> lock{ m_mutex };
+        m_workAvailable.notify_one();
+    }
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief How a single worker of a TaskScheduler has spent its time.
+ */
+struct WorkerStatistics
+{
+    // The time spent running tasks:
+    std::chrono::nanoseconds busyTime;
+
+    // The time spent asleep, waiting for tasks to be posted:
+    std::chrono::nanoseconds idleTime;
+
+    std::uint64_t taskCount;
+};
+
+/**
+ * @brief A fixed-size pool of worker threads that balances its load through work stealing.
+ *
+ * Every worker owns a double-ended queue. Tasks posted by a worker go onto the back of its own
+ * queue, and are also taken from the back, so that each worker proceeds depth-first through the
+ * work that it discovers itself. This keeps the number of queued tasks small. A worker that runs
+ * out of work steals from the front of another worker's queue instead, where the oldest, and
+ * typically largest, pieces of work are found.
+ *
+ * Since no single queue is shared by all workers, contention stays low as the number of workers
+ * grows.
+ */
+class TaskScheduler
+{
+  public:
+    using Task = std::function<void()>;
+
+    /**
+     * @brief Starts the worker threads.
+     *
+     * @param[in] threadCount         The number of worker threads to start. If zero, one worker is
+     *                                started for every hardware thread.
+     */
+    explicit TaskScheduler(unsigned int threadCount = 0);
+
+    /**
+     * @brief Stops and joins the worker threads. Tasks that haven't started yet are discarded.
+     */
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    /**
+     * @brief Queues a task for execution. Tasks may post further tasks.
+     *
+     * When called from one of the scheduler's own workers, the task is queued locally. Otherwise,
+     * the task is handed to the workers in a round-robin fashion.
+     */
+    void Post(Task task);
+
+    /**
+     * @brief Blocks until every task that has been posted, including the tasks that those tasks
+     * posted in turn, has finished.
+     */
+    void Wait();
+
+    /**
+     * @returns The number of worker threads.
+     */
+    std::size_t GetThreadCount() const noexcept;
+
+    /**
+     * @returns The number of tasks that have been posted, but that no worker has picked up yet.
+     */
+    std::size_t GetQueuedTaskCount() const noexcept;
+
+    /**
+     * @returns How each worker has spent its time since the statistics were last reset.
+     */
+    std::vector<WorkerStatistics> GetWorkerStatistics() const;
+
+    /**
+     * @brief Resets the statistics of every worker.
+     *
+     * @note Shouldn't be called while tasks are running.
+     */
+    void ResetStatistics() noexcept;
+
+  private:
+    // Each queue lives on its own cache line, so that workers don't contend through false sharing:
+    struct alignas(64) WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+
+        // Only written by the worker itself, so these get a cache line of their own, rather than
+        // sharing the one that other workers touch when stealing. In nanoseconds:
+        alignas(64) std::atomic<std::int64_t> busyTime{ 0 };
+        std::atomic<std::int64_t> idleTime{ 0 };
+        std::atomic<std::uint64_t> taskCount{ 0 };
+    };
+
+    void RunWorker(std::size_t index);
+
+    bool TryPopLocal(std::size_t index, Task& task);
+
+    bool TrySteal(std::size_t index, Task& task);
+
+    void Push(std::size_t index, Task task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    // The number of tasks that have been posted, but haven't finished yet:
+    std::atomic<std::size_t> m_pendingTaskCount{ 0 };
+
+    // The number of tasks that are sitting in one of the queues:
+    std::atomic<std::size_t> m_queuedTaskCount{ 0 };
+
+    std::atomic<std::size_t> m_sleepingWorkerCount{ 0 };
+    std::atomic<std::size_t> m_nextQueue{ 0 };
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_allTasksFinished;
+
+    std::atomic<bool> m_isStopping{ false };
+
+    // When the statistics were last reset, in nanoseconds since the epoch of
+    // `std::chrono::steady_clock`, so that workers asleep at that time only count what follows:
+    std::atomic<std::int64_t> m_statisticsResetTime{ 0 };
+};
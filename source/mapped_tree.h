@@ -0,0 +1,1033 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // Win32
+
+#include "tree.h"
+#include "tree_serialization.h"
+
+namespace TreeUtilities
+{
+namespace Detail
+{
+constexpr char MappedMagic[4] = { 'T', 'M', 'A', 'P' };
+constexpr std::uint32_t MappedVersion{ 1 };
+constexpr std::uint32_t MappedByteOrderMark{ 0x01020304 };
+constexpr std::uint32_t NoMappedNode{ 0xFFFFFFFF };
+
+/**
+ * @brief The header at the start of every mapped tree file.
+ */
+struct MappedHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t byteOrderMark;
+    std::uint32_t recordSize;
+    std::uint32_t payloadSize;
+    std::uint32_t reserved;
+    std::uint64_t nodeCount;
+    std::uint64_t nodeSectionOffset;
+    std::uint64_t stringSectionOffset;
+    std::uint64_t stringSectionSize;
+};
+
+/**
+ * @brief The fixed-size portion of each Node record. Records are laid out in pre-order, so the
+ * first child of a Node, if it has one, is always the record immediately following it. The
+ * user-defined payload directly follows this structure.
+ */
+struct MappedRecord
+{
+    std::uint32_t parent;
+    std::uint32_t previousSibling;
+    std::uint32_t nextSibling;
+    std::uint32_t lastChild;
+    std::uint32_t childCount;
+    std::uint32_t subtreeSize;
+    std::uint32_t nameLength;
+    std::uint32_t reserved;
+    std::uint64_t nameOffset;
+};
+
+static_assert(sizeof(MappedHeader) % 8 == 0);
+static_assert(sizeof(MappedRecord) % 8 == 0);
+
+template <typename PayloadType> constexpr std::uint32_t MappedRecordSize() noexcept
+{
+    return static_cast<std::uint32_t>(sizeof(MappedRecord) + (sizeof(PayloadType) + 7) / 8 * 8);
+}
+
+/**
+ * @brief A read-only memory mapping of an entire file.
+ */
+class MappedFile
+{
+  public:
+    MappedFile() noexcept = default;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+        : m_data{ std::exchange(other.m_data, nullptr) }, m_size{ std::exchange(other.m_size, 0) }
+    {
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other) {
+            Unmap();
+
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+        }
+
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        Unmap();
+    }
+
+    /**
+     * @brief Maps the specified file into memory.
+     *
+     * @returns True if the file was mapped successfully.
+     */
+    bool Map(const std::filesystem::path& path) noexcept
+    {
+        Unmap();
+
+#ifdef WIN32
+        const auto file = CreateFileW(
+            path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        const auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+
+        if (!mapping) {
+            return false;
+        }
+
+        const auto* const view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+
+        if (!view) {
+            return false;
+        }
+
+        m_data = static_cast<const std::byte*>(view);
+        m_size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+        const auto file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0) {
+            return false;
+        }
+
+        struct stat status;
+        if (fstat(file, &status) != 0 || status.st_size == 0) {
+            close(file);
+            return false;
+        }
+
+        const auto size = static_cast<std::size_t>(status.st_size);
+        auto* const view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+
+        if (view == MAP_FAILED) {
+            return false;
+        }
+
+        m_data = static_cast<const std::byte*>(view);
+        m_size = size;
+#endif // Win32
+
+        return true;
+    }
+
+    const std::byte* GetData() const noexcept
+    {
+        return m_data;
+    }
+
+    std::size_t GetSize() const noexcept
+    {
+        return m_size;
+    }
+
+  private:
+    void Unmap() noexcept
+    {
+        if (!m_data) {
+            return;
+        }
+
+#ifdef WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<std::byte*>(m_data), m_size);
+#endif // Win32
+
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const std::byte* m_data{ nullptr };
+    std::size_t m_size{ 0 };
+};
+} // namespace Detail
+
+/**
+ * @brief How much of a mapped tree file is checked when it's opened.
+ */
+enum class MappedValidation
+{
+    // Only the header is checked, which keeps opening the file a constant-time operation. Use
+    // this for files that were written by a trusted process:
+    HeaderOnly,
+
+    // Every record is checked as well, so that no traversal can read out of bounds, or get stuck
+    // in a cycle. This takes time linear in the number of Nodes, and touches every page of the
+    // node section. Use this for files from untrusted sources:
+    AllRecords
+};
+
+/**
+ * @brief A read-only tree that is traversed in place, directly from a memory-mapped file written by
+ * SaveMapped(...).
+ *
+ * Opening a MappedTree takes constant time, regardless of the size of the tree, since no Nodes are
+ * materialized on the heap. Instead, pages are faulted in by the operating system as they are
+ * touched. Every Node exposes a name, stored in a separate string section, as well as a
+ * fixed-size, trivially copyable payload.
+ *
+ * @note By default, the contents of the file are trusted, and only the header is validated when
+ * opening it; see MappedValidation.
+ */
+template <typename PayloadType> class MappedTree
+{
+  public:
+    static_assert(std::is_trivially_copyable_v<PayloadType>);
+    static_assert(alignof(PayloadType) <= 8);
+
+    class Node;
+
+    class Iterator;
+    class PreOrderIterator;
+    class PostOrderIterator;
+    class LeafIterator;
+    class SiblingIterator;
+
+    // Typedefs needed for STL compliance:
+    using value_type = Node;
+    using reference = const Node&;
+    using const_reference = const Node&;
+
+    MappedTree(MappedTree&&) noexcept = default;
+    MappedTree& operator=(MappedTree&&) noexcept = default;
+
+    /**
+     * @brief Maps the specified file into memory.
+     *
+     * @param[in] path                The file to map.
+     * @param[in] validation          Whether to check every record, or just the header.
+     *
+     * @returns The mapped tree, or std::nullopt if the file could not be mapped, if it wasn't
+     * written by SaveMapped(...) using the same payload type on a machine with the same byte order,
+     * or if the requested validation failed.
+     */
+    static std::optional<MappedTree> Open(
+        const std::filesystem::path& path,
+        MappedValidation validation = MappedValidation::HeaderOnly) noexcept
+    {
+        Detail::MappedFile file;
+        if (!file.Map(path) || file.GetSize() < sizeof(Detail::MappedHeader)) {
+            return std::nullopt;
+        }
+
+        Detail::MappedHeader header;
+        std::memcpy(&header, file.GetData(), sizeof(header));
+
+        const auto fileSize = file.GetSize();
+
+        const bool isValid =
+            std::memcmp(header.magic, Detail::MappedMagic, sizeof(header.magic)) == 0 &&
+            header.version == Detail::MappedVersion &&
+            header.byteOrderMark == Detail::MappedByteOrderMark &&
+            header.recordSize == RecordSize && header.payloadSize == sizeof(PayloadType) &&
+            header.nodeCount > 0 &&
+            header.nodeCount < Detail::NoMappedNode && header.nodeSectionOffset % 8 == 0 &&
+            header.nodeSectionOffset <= fileSize &&
+            header.nodeCount * RecordSize <= fileSize - header.nodeSectionOffset &&
+            header.stringSectionOffset <= fileSize &&
+            header.stringSectionSize <= fileSize - header.stringSectionOffset;
+
+        if (!isValid) {
+            return std::nullopt;
+        }
+
+        MappedTree tree{ std::move(file), header };
+        if (validation == MappedValidation::AllRecords &&
+            !tree.HasValidRecords(header.stringSectionSize)) {
+            return std::nullopt;
+        }
+
+        return tree;
+    }
+
+    /**
+     * @returns The root Node.
+     */
+    Node GetRoot() const noexcept
+    {
+        return Node{ m_nodes, m_strings, 0 };
+    }
+
+    /**
+     * @returns The total number of Nodes in the tree.
+     *
+     * @complexity Constant.
+     */
+    std::size_t Size() const noexcept
+    {
+        return static_cast<std::size_t>(m_nodeCount);
+    }
+
+    /**
+     * @returns A pre-order iterator that will iterate over all Nodes in the tree.
+     */
+    PreOrderIterator beginPreOrder() const noexcept
+    {
+        return PreOrderIterator{ GetRoot() };
+    }
+
+    /**
+     * @returns A pre-order iterator pointing "past" the end of the tree.
+     */
+    PreOrderIterator endPreOrder() const noexcept
+    {
+        return PreOrderIterator{};
+    }
+
+    /**
+     * @returns A post-order iterator that will iterate over all Nodes in the tree.
+     */
+    PostOrderIterator begin() const noexcept
+    {
+        return PostOrderIterator{ GetRoot() };
+    }
+
+    /**
+     * @returns A post-order iterator that points past the end of the tree.
+     */
+    PostOrderIterator end() const noexcept
+    {
+        return PostOrderIterator{};
+    }
+
+    /**
+     * @returns An iterator that will iterate over all leaf Nodes in the tree.
+     */
+    LeafIterator beginLeaf() const noexcept
+    {
+        return LeafIterator{ GetRoot() };
+    }
+
+    /**
+     * @returns A LeafIterator that points past the last leaf Node in the tree.
+     */
+    LeafIterator endLeaf() const noexcept
+    {
+        return LeafIterator{};
+    }
+
+  private:
+    MappedTree(Detail::MappedFile file, const Detail::MappedHeader& header) noexcept
+        : m_file{ std::move(file) },
+          m_nodes{ m_file.GetData() + header.nodeSectionOffset },
+          m_strings{ reinterpret_cast<const char*>(m_file.GetData() + header.stringSectionOffset) },
+          m_nodeCount{ static_cast<std::uint32_t>(header.nodeCount) }
+    {
+    }
+
+    /**
+     * @brief Checks that every record describes the pre-order layout that SaveMapped(...) produces,
+     * and that every name lies within the string section.
+     *
+     * The subtree sizes alone determine the shape of the tree, so the other links of each record
+     * are compared against the ones derived from those sizes, in the same way that they were
+     * derived when the file was written.
+     */
+    bool HasValidRecords(std::uint64_t stringSectionSize) const noexcept
+    {
+        struct Ancestor
+        {
+            std::uint32_t index;
+            std::uint32_t end;
+            std::uint32_t lastChild;
+            std::uint32_t childCount;
+        };
+
+        const auto hasValidChildren = [&](const Ancestor& ancestor) noexcept {
+            const auto& record = GetRecord(ancestor.index);
+            return record.lastChild == ancestor.lastChild &&
+                   record.childCount == ancestor.childCount;
+        };
+
+        std::vector<Ancestor> ancestors;
+
+        try {
+            ancestors.reserve(64);
+        } catch (const std::bad_alloc&) {
+            return false;
+        }
+
+        for (std::uint32_t index = 0; index < m_nodeCount; ++index) {
+            while (!ancestors.empty() && ancestors.back().end <= index) {
+                if (!hasValidChildren(ancestors.back())) {
+                    return false;
+                }
+
+                ancestors.pop_back();
+            }
+
+            if (index != 0 && ancestors.empty()) {
+                return false;
+            }
+
+            const auto& record = GetRecord(index);
+            const auto parentEnd = ancestors.empty() ? m_nodeCount : ancestors.back().end;
+
+            if (record.subtreeSize == 0 || record.subtreeSize > parentEnd - index ||
+                (index == 0 && record.subtreeSize != m_nodeCount)) {
+                return false;
+            }
+
+            const auto end = index + record.subtreeSize;
+
+            const auto expectedParent =
+                ancestors.empty() ? Detail::NoMappedNode : ancestors.back().index;
+            const auto expectedPreviousSibling =
+                ancestors.empty() ? Detail::NoMappedNode : ancestors.back().lastChild;
+            const auto expectedNextSibling = end < parentEnd ? end : Detail::NoMappedNode;
+
+            if (record.parent != expectedParent ||
+                record.previousSibling != expectedPreviousSibling ||
+                record.nextSibling != expectedNextSibling) {
+                return false;
+            }
+
+            if (record.nameOffset > stringSectionSize ||
+                record.nameLength > stringSectionSize - record.nameOffset) {
+                return false;
+            }
+
+            if (!ancestors.empty()) {
+                ancestors.back().lastChild = index;
+                ++ancestors.back().childCount;
+            }
+
+            try {
+                ancestors.push_back({ index, end, Detail::NoMappedNode, 0 });
+            } catch (const std::bad_alloc&) {
+                return false;
+            }
+        }
+
+        return std::all_of(std::begin(ancestors), std::end(ancestors), hasValidChildren);
+    }
+
+    const Detail::MappedRecord& GetRecord(std::uint32_t index) const noexcept
+    {
+        assert(index < m_nodeCount);
+
+        return ReadRecord(m_nodes, index);
+    }
+
+    // These take the mapped sections rather than the tree itself, since the mapping stays put
+    // when the MappedTree is moved, and Node handles would otherwise dangle:
+
+    static const Detail::MappedRecord&
+    ReadRecord(const std::byte* nodes, std::uint32_t index) noexcept
+    {
+        const auto* const record = nodes + std::size_t{ index } * RecordSize;
+        return *reinterpret_cast<const Detail::MappedRecord*>(record);
+    }
+
+    static const PayloadType& ReadPayload(const std::byte* nodes, std::uint32_t index) noexcept
+    {
+        const auto* const record = nodes + std::size_t{ index } * RecordSize;
+        return *reinterpret_cast<const PayloadType*>(record + sizeof(Detail::MappedRecord));
+    }
+
+    static std::string_view
+    ReadName(const std::byte* nodes, const char* strings, std::uint32_t index) noexcept
+    {
+        const auto& record = ReadRecord(nodes, index);
+        return std::string_view{ strings + record.nameOffset, record.nameLength };
+    }
+
+    static constexpr std::uint32_t RecordSize{ Detail::MappedRecordSize<PayloadType>() };
+
+    Detail::MappedFile m_file;
+
+    const std::byte* m_nodes{ nullptr };
+    const char* m_strings{ nullptr };
+
+    std::uint32_t m_nodeCount{ 0 };
+};
+
+/**
+ * @brief A lightweight handle to a Node in a MappedTree. Handles are cheap to copy, and refer to
+ * the mapping rather than to the MappedTree object, so they remain valid across moves of the tree
+ * for as long as the mapping itself is alive.
+ */
+template <typename PayloadType> class MappedTree<PayloadType>::Node
+{
+  public:
+    /**
+     * @brief Default constructs a handle that doesn't refer to any Node.
+     */
+    Node() noexcept = default;
+
+    /**
+     * @returns True if the handle refers to a Node.
+     */
+    explicit operator bool() const noexcept
+    {
+        return m_index != Detail::NoMappedNode;
+    }
+
+    /**
+     * @returns True if both handles refer to the same Node.
+     */
+    friend bool operator==(const Node& lhs, const Node& rhs) noexcept
+    {
+        return lhs.m_nodes == rhs.m_nodes && lhs.m_index == rhs.m_index;
+    }
+
+    /**
+     * @returns True if the handles refer to different Nodes.
+     */
+    friend bool operator!=(const Node& lhs, const Node& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+    /**
+     * @returns The name stored alongside the Node.
+     */
+    std::string_view GetName() const noexcept
+    {
+        return MappedTree::ReadName(m_nodes, m_strings, m_index);
+    }
+
+    /**
+     * @returns The fixed-size payload stored in the Node.
+     */
+    const PayloadType& GetData() const noexcept
+    {
+        return MappedTree::ReadPayload(m_nodes, m_index);
+    }
+
+    /**
+     * @overload
+     */
+    const PayloadType* operator->() const noexcept
+    {
+        return &GetData();
+    }
+
+    /**
+     * @returns The Node's parent, if it exists; an invalid handle otherwise.
+     */
+    Node GetParent() const noexcept
+    {
+        return Node{ m_nodes, m_strings, GetRecord().parent };
+    }
+
+    /**
+     * @returns The Node's first child, if it exists; an invalid handle otherwise.
+     */
+    Node GetFirstChild() const noexcept
+    {
+        return Node{ m_nodes, m_strings, HasChildren() ? m_index + 1 : Detail::NoMappedNode };
+    }
+
+    /**
+     * @returns The Node's last child, if it exists; an invalid handle otherwise.
+     */
+    Node GetLastChild() const noexcept
+    {
+        return Node{ m_nodes, m_strings, GetRecord().lastChild };
+    }
+
+    /**
+     * @returns The Node's next sibling, if it exists; an invalid handle otherwise.
+     */
+    Node GetNextSibling() const noexcept
+    {
+        return Node{ m_nodes, m_strings, GetRecord().nextSibling };
+    }
+
+    /**
+     * @returns The Node's previous sibling, if it exists; an invalid handle otherwise.
+     */
+    Node GetPreviousSibling() const noexcept
+    {
+        return Node{ m_nodes, m_strings, GetRecord().previousSibling };
+    }
+
+    /**
+     * @returns True if this Node has direct descendants.
+     */
+    bool HasChildren() const noexcept
+    {
+        return GetRecord().childCount > 0;
+    }
+
+    /**
+     * @returns The number of direct descendants that this Node has.
+     */
+    unsigned int GetChildCount() const noexcept
+    {
+        return GetRecord().childCount;
+    }
+
+    /**
+     * @returns The total number of descendant Nodes belonging to the Node.
+     *
+     * @complexity Constant.
+     */
+    std::size_t CountAllDescendants() const noexcept
+    {
+        return GetRecord().subtreeSize - 1;
+    }
+
+  private:
+    friend class MappedTree<PayloadType>;
+
+    Node(const std::byte* nodes, const char* strings, std::uint32_t index) noexcept
+        : m_nodes{ nodes }, m_strings{ strings }, m_index{ index }
+    {
+    }
+
+    const Detail::MappedRecord& GetRecord() const noexcept
+    {
+        return MappedTree::ReadRecord(m_nodes, m_index);
+    }
+
+    const std::byte* m_nodes{ nullptr };
+    const char* m_strings{ nullptr };
+
+    std::uint32_t m_index{ Detail::NoMappedNode };
+};
+
+/**
+ * @brief The base iterator for MappedTree.
+ *
+ * Since Nodes in a MappedTree are handles rather than heap objects, each iterator holds the handle
+ * that it currently points to.
+ */
+template <typename PayloadType> class MappedTree<PayloadType>::Iterator
+{
+  public:
+    // Typedefs needed for STL compliance:
+    using value_type = Node;
+    using pointer = const Node*;
+    using reference = const Node&;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    /**
+     * @returns True if the iterator points to a valid Node; false otherwise.
+     */
+    explicit operator bool() const noexcept
+    {
+        return static_cast<bool>(m_currentNode);
+    }
+
+    /**
+     * @returns The Node pointed to by the iterator.
+     */
+    const Node& operator*() const noexcept
+    {
+        return m_currentNode;
+    }
+
+    /**
+     * @returns A pointer to the Node pointed to by the iterator.
+     */
+    const Node* operator->() const noexcept
+    {
+        return &m_currentNode;
+    }
+
+    /**
+     * @returns True if the iterator points to the same Node as the other iterator.
+     */
+    bool operator==(const Iterator& other) const noexcept
+    {
+        return m_currentNode.m_index == other.m_currentNode.m_index;
+    }
+
+    /**
+     * @returns True if the iterator points to a different Node than the other iterator.
+     */
+    bool operator!=(const Iterator& other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+  protected:
+    Iterator() noexcept = default;
+
+    explicit Iterator(Node node) noexcept : m_currentNode{ node }, m_startingNode{ node }
+    {
+    }
+
+    Node m_currentNode;
+    Node m_startingNode;
+};
+
+/**
+ * @brief A pre-order iterator for MappedTree.
+ *
+ * Since records are stored in pre-order, advancing this iterator is a simple increment.
+ */
+template <typename PayloadType>
+class MappedTree<PayloadType>::PreOrderIterator final : public MappedTree<PayloadType>::Iterator
+{
+  public:
+    PreOrderIterator() noexcept = default;
+
+    explicit PreOrderIterator(Node node) noexcept : Iterator{ node }
+    {
+        if (node) {
+            m_endingIndex = node.m_index + node.GetRecord().subtreeSize;
+        }
+    }
+
+    PreOrderIterator& operator++() noexcept
+    {
+        assert(this->m_currentNode);
+
+        auto& index = this->m_currentNode.m_index;
+        index = (index + 1 < m_endingIndex) ? index + 1 : Detail::NoMappedNode;
+
+        return *this;
+    }
+
+    PreOrderIterator operator++(int) noexcept
+    {
+        const auto result = *this;
+        ++(*this);
+
+        return result;
+    }
+
+  private:
+    std::uint32_t m_endingIndex{ 0 };
+};
+
+/**
+ * @brief A post-order iterator for MappedTree.
+ */
+template <typename PayloadType>
+class MappedTree<PayloadType>::PostOrderIterator final : public MappedTree<PayloadType>::Iterator
+{
+  public:
+    PostOrderIterator() noexcept = default;
+
+    explicit PostOrderIterator(Node node) noexcept : Iterator{ node }
+    {
+        if (!node) {
+            return;
+        }
+
+        while (this->m_currentNode.HasChildren()) {
+            this->m_currentNode = this->m_currentNode.GetFirstChild();
+        }
+    }
+
+    PostOrderIterator& operator++() noexcept
+    {
+        assert(this->m_currentNode);
+
+        auto& node = this->m_currentNode;
+
+        if (node == this->m_startingNode) {
+            node = Node{};
+        } else if (const auto sibling = node.GetNextSibling()) {
+            node = sibling;
+            while (node.HasChildren()) {
+                node = node.GetFirstChild();
+            }
+        } else {
+            node = node.GetParent();
+        }
+
+        return *this;
+    }
+
+    PostOrderIterator operator++(int) noexcept
+    {
+        const auto result = *this;
+        ++(*this);
+
+        return result;
+    }
+};
+
+/**
+ * @brief A leaf iterator for MappedTree.
+ *
+ * Leaves appear in the same relative order in pre-order as they do in a left-to-right sweep, so
+ * this iterator simply skips over every interior record.
+ */
+template <typename PayloadType>
+class MappedTree<PayloadType>::LeafIterator final : public MappedTree<PayloadType>::Iterator
+{
+  public:
+    LeafIterator() noexcept = default;
+
+    explicit LeafIterator(Node node) noexcept : Iterator{ node }
+    {
+        if (!node) {
+            return;
+        }
+
+        m_endingIndex = node.m_index + node.GetRecord().subtreeSize;
+        while (this->m_currentNode.HasChildren()) {
+            this->m_currentNode = this->m_currentNode.GetFirstChild();
+        }
+    }
+
+    LeafIterator& operator++() noexcept
+    {
+        assert(this->m_currentNode);
+
+        auto& node = this->m_currentNode;
+
+        do {
+            ++node.m_index;
+        } while (node.m_index < m_endingIndex && node.HasChildren());
+
+        if (node.m_index >= m_endingIndex) {
+            node = Node{};
+        }
+
+        return *this;
+    }
+
+    LeafIterator operator++(int) noexcept
+    {
+        const auto result = *this;
+        ++(*this);
+
+        return result;
+    }
+
+  private:
+    std::uint32_t m_endingIndex{ 0 };
+};
+
+/**
+ * @brief A sibling iterator for MappedTree.
+ */
+template <typename PayloadType>
+class MappedTree<PayloadType>::SiblingIterator final : public MappedTree<PayloadType>::Iterator
+{
+  public:
+    SiblingIterator() noexcept = default;
+
+    explicit SiblingIterator(Node node) noexcept : Iterator{ node }
+    {
+    }
+
+    SiblingIterator& operator++() noexcept
+    {
+        if (this->m_currentNode) {
+            this->m_currentNode = this->m_currentNode.GetNextSibling();
+        }
+
+        return *this;
+    }
+
+    SiblingIterator operator++(int) noexcept
+    {
+        const auto result = *this;
+        ++(*this);
+
+        return result;
+    }
+};
+
+/**
+ * @brief Writes a tree in the layout expected by MappedTree.
+ *
+ * The tree is traversed three times: once to compute the size and last child of every subtree,
+ * once to emit the fixed-size Node records, and once to emit the string section.
+ *
+ * @param[in] tree                The tree to save.
+ * @param[out] stream             The stream to write to. This should be opened in binary mode.
+ * @param[in] codec               Splits the data in each Node into a name and a payload. This type
+ *                                should provide the following two functions:
+ *                                   std::string_view Name(const DataType& data) const;
+ *                                   PayloadType Payload(const DataType& data) const;
+ *                                The name may also be returned as a `std::string`.
+ *
+ * @returns True if the tree was written successfully, and false if the stream failed or if the
+ * tree is too large to be indexed by 32-bit offsets.
+ */
+template <typename DataType, typename CodecType>
+bool SaveMapped(const Tree<DataType>& tree, std::ostream& stream, const CodecType& codec)
+{
+    using NodeType = typename Tree<DataType>::Node;
+    using PayloadType = std::decay_t<decltype(codec.Payload(std::declval<const DataType&>()))>;
+
+    static_assert(std::is_trivially_copyable_v<PayloadType>);
+
+    // First pass: compute the size and last child of every subtree, indexed in pre-order:
+    std::vector<std::uint32_t> subtreeSizes;
+    std::vector<std::uint32_t> lastChildren;
+    std::uint64_t stringSectionSize{ 0 };
+
+    {
+        std::vector<std::pair<const NodeType*, std::uint32_t>> ancestors;
+
+        const auto closeSubtreesUntil = [&](const NodeType* parent) {
+            while (!ancestors.empty() && ancestors.back().first != parent) {
+                const auto index = ancestors.back().second;
+                subtreeSizes[index] = static_cast<std::uint32_t>(subtreeSizes.size() - index);
+                ancestors.pop_back();
+            }
+        };
+
+        for (auto itr = tree.beginPreOrder(); itr != tree.endPreOrder(); ++itr) {
+            if (subtreeSizes.size() >= Detail::NoMappedNode) {
+                return false;
+            }
+
+            const auto index = static_cast<std::uint32_t>(subtreeSizes.size());
+
+            closeSubtreesUntil(itr->GetParent());
+            if (!ancestors.empty()) {
+                lastChildren[ancestors.back().second] = index;
+            }
+
+            ancestors.emplace_back(&(*itr), index);
+            subtreeSizes.emplace_back(0);
+            lastChildren.emplace_back(Detail::NoMappedNode);
+
+            stringSectionSize += std::string_view{ codec.Name(itr->GetData()) }.size();
+        }
+
+        closeSubtreesUntil(nullptr);
+    }
+
+    constexpr auto recordSize = Detail::MappedRecordSize<PayloadType>();
+
+    Detail::MappedHeader header{};
+    std::memcpy(header.magic, Detail::MappedMagic, sizeof(header.magic));
+    header.version = Detail::MappedVersion;
+    header.byteOrderMark = Detail::MappedByteOrderMark;
+    header.recordSize = recordSize;
+    header.payloadSize = static_cast<std::uint32_t>(sizeof(PayloadType));
+    header.nodeCount = subtreeSizes.size();
+    header.nodeSectionOffset = sizeof(Detail::MappedHeader);
+    header.stringSectionOffset = header.nodeSectionOffset + header.nodeCount * recordSize;
+    header.stringSectionSize = stringSectionSize;
+
+    BinaryWriter writer{ stream };
+    writer.WriteBytes(&header, sizeof(header));
+
+    // Second pass: emit the records, tracking each Node's parent and previous sibling:
+    {
+        // Pairs each open ancestor with the index of its most recently emitted child:
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> ancestors;
+
+        std::uint32_t index{ 0 };
+        std::uint64_t nameOffset{ 0 };
+
+        std::byte record[recordSize] = {};
+
+        for (auto itr = tree.beginPreOrder(); itr != tree.endPreOrder(); ++itr, ++index) {
+            while (!ancestors.empty() &&
+                   ancestors.back().first + subtreeSizes[ancestors.back().first] <= index) {
+                ancestors.pop_back();
+            }
+
+            Detail::MappedRecord fields{};
+            fields.parent = ancestors.empty() ? Detail::NoMappedNode : ancestors.back().first;
+            fields.previousSibling =
+                ancestors.empty() ? Detail::NoMappedNode : ancestors.back().second;
+            fields.nextSibling =
+                itr->GetNextSibling() ? index + subtreeSizes[index] : Detail::NoMappedNode;
+            fields.lastChild = lastChildren[index];
+            fields.childCount = itr->GetChildCount();
+            fields.subtreeSize = subtreeSizes[index];
+            fields.nameOffset = nameOffset;
+
+            const auto name = codec.Name(itr->GetData());
+            fields.nameLength = static_cast<std::uint32_t>(std::string_view{ name }.size());
+            nameOffset += fields.nameLength;
+
+            const auto payload = codec.Payload(itr->GetData());
+
+            std::memcpy(record, &fields, sizeof(fields));
+            std::memcpy(record + sizeof(fields), &payload, sizeof(payload));
+            writer.WriteBytes(record, recordSize);
+
+            if (!ancestors.empty()) {
+                ancestors.back().second = index;
+            }
+
+            ancestors.emplace_back(index, Detail::NoMappedNode);
+        }
+    }
+
+    // Third pass: emit the names:
+    std::for_each(tree.beginPreOrder(), tree.endPreOrder(), [&](const auto& node) {
+        const auto name = codec.Name(node.GetData());
+        const auto view = std::string_view{ name };
+
+        writer.WriteBytes(view.data(), view.size());
+    });
+
+    return writer.Flush();
+}
+} // namespace TreeUtilities
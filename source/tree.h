@@ -25,8 +25,43 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <functional>
 #include <iterator>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Selects the optional bookkeeping that every Node of a Tree<DataType> carries.
+ *
+ * Both features are disabled by default, which keeps a Node down to its links, its data, and a
+ * few flags. To opt in, specialize this template for the data type before the first Tree of that
+ * type is instantiated:
+ *
+ *    template <> struct TreeTraits<MyData>
+ *    {
+ *        static constexpr bool EnableSubtreeHashes = true;
+ *        static constexpr bool EnableChildIndex = false;
+ *    };
+ *
+ * Subtree hashes cost eight bytes per Node, and are needed by Tree::UpdateSubtreeHashes(...) and
+ * Node::GetSubtreeHash(); TreeUtilities::Diff(...) works either way, but can only skip identical
+ * subtrees when they're enabled. The child index costs a pointer per Node, and is needed by
+ * Node::EnableChildIndex(...).
+ */
+template <typename DataType> struct TreeTraits
+{
+    static constexpr bool EnableSubtreeHashes = false;
+    static constexpr bool EnableChildIndex = false;
+};
 
 /**
  * The Tree class declares a basic tree, built on top of templatized Node nodes.
@@ -71,6 +106,17 @@ template <typename DataType> class Tree
     {
     }
 
+    /**
+     * @brief Move constructor.
+     *
+     * @note The moved-from Tree is left without a root, and should only be destroyed or assigned
+     * to.
+     */
+    Tree(Tree<DataType>&& other) noexcept : m_root{ other.m_root }
+    {
+        other.m_root = nullptr;
+    }
+
     /**
      * @brief Assignment operator.
      */
@@ -83,8 +129,7 @@ template <typename DataType> class Tree
     /**
      * @brief Swaps all member variables of the left-hand side with that of the right-hand side.
      */
-    friend void
-    swap(Tree<DataType>& lhs, Tree<DataType>& rhs) noexcept(noexcept(swap(lhs.m_root, rhs.m_root)))
+    friend void swap(Tree<DataType>& lhs, Tree<DataType>& rhs) noexcept
     {
         // Enable Argument Dependent Lookup (ADL):
         using std::swap;
@@ -101,6 +146,22 @@ template <typename DataType> class Tree
         delete m_root;
     }
 
+    /**
+     * @brief Detaches the specified Node from the Tree it's part of, and turns it into the root of
+     * a new Tree.
+     *
+     * @complexity Constant; no Nodes are copied or allocated.
+     *
+     * @param[in] node                The Node to extract. This may not be the root of a Tree.
+     *
+     * @returns A Tree that takes ownership of the Node and all of its descendants.
+     */
+    static Tree<DataType> Extract(Node& node) noexcept
+    {
+        assert(node.GetParent() && "The root of a Tree cannot be extracted.");
+        return Tree<DataType>{ AdoptRootTag{}, node.Detach() };
+    }
+
     /**
      * @returns A pointer to the root Node.
      */
@@ -139,6 +200,104 @@ template <typename DataType> class Tree
         return depth;
     }
 
+    /**
+     * @brief Brings the subtree hash of every Node in the Tree up to date, spreading the work
+     * over multiple threads.
+     *
+     * Only Nodes whose hashes were invalidated since the last update are revisited. The stale
+     * portion of the Tree is split into independent subtrees that are hashed concurrently, after
+     * which the remaining ancestors are folded in serially.
+     *
+     * @param[in] hasher              A callable that hashes the data of a single Node, and that can
+     *                                safely be invoked from multiple threads at once. This type
+     *                                should be equivalent to:
+     *                                   std::uint64_t hasher(const DataType& data) noexcept;
+     * @param[in] threadCount         The maximum number of threads to use.
+     *
+     * @returns The subtree hash of the root Node.
+     */
+    template <typename HasherType>
+    std::uint64_t UpdateSubtreeHashes(
+        const HasherType& hasher, unsigned int threadCount = std::thread::hardware_concurrency())
+    {
+        static_assert(
+            TreeTraits<DataType>::EnableSubtreeHashes,
+            "Subtree hashes need to be enabled through TreeTraits<DataType>.");
+
+        if (!m_root->IsSubtreeHashStale()) {
+            return m_root->GetSubtreeHash();
+        }
+
+        // Split the stale nodes into enough independent subtrees to keep every thread busy:
+        const auto desiredTaskCount = 8 * static_cast<std::size_t>(std::max(threadCount, 1u));
+
+        std::vector<Node*> interiorNodes;
+        std::vector<Node*> frontier{ m_root };
+
+        while (frontier.size() < desiredTaskCount) {
+            std::vector<Node*> nextFrontier;
+            nextFrontier.reserve(frontier.size());
+
+            for (auto* node : frontier) {
+                const auto staleChildCount = std::count_if(
+                    SiblingIterator{ node->GetFirstChild() }, SiblingIterator{},
+                    [](const Node& child) noexcept { return child.IsSubtreeHashStale(); });
+
+                if (staleChildCount == 0) {
+                    nextFrontier.emplace_back(node);
+                    continue;
+                }
+
+                interiorNodes.emplace_back(node);
+                for (auto* child = node->GetFirstChild(); child; child = child->GetNextSibling()) {
+                    if (child->IsSubtreeHashStale()) {
+                        nextFrontier.emplace_back(child);
+                    }
+                }
+            }
+
+            if (nextFrontier == frontier) {
+                break;
+            }
+
+            frontier = std::move(nextFrontier);
+        }
+
+        const auto workerCount = std::min<std::size_t>(threadCount, frontier.size());
+        if (workerCount <= 1) {
+            return m_root->UpdateSubtreeHash(hasher);
+        }
+
+        std::atomic<std::size_t> nextTask{ 0 };
+        const auto worker = [&]() noexcept {
+            for (auto index = nextTask.fetch_add(1); index < frontier.size();
+                 index = nextTask.fetch_add(1)) {
+                frontier[index]->UpdateSubtreeHash(hasher);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(workerCount - 1);
+
+        for (std::size_t index = 1; index < workerCount; ++index) {
+            threads.emplace_back(worker);
+        }
+
+        worker();
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        // Interior nodes were recorded level by level, so walking them in reverse guarantees that
+        // every child is up to date by the time its parent gets hashed:
+        std::for_each(
+            interiorNodes.rbegin(), interiorNodes.rend(),
+            [&](Node* node) { node->UpdateSubtreeHash(hasher); });
+
+        return m_root->GetSubtreeHash();
+    }
+
     /**
      * @returns A pre-order iterator that will iterate over all Nodes in the tree.
      */
@@ -196,6 +355,20 @@ template <typename DataType> class Tree
     }
 
   private:
+    class ChildIndex;
+    template <typename KeyExtractorType> class KeyedChildIndex;
+
+    struct AdoptRootTag
+    {
+    };
+
+    /**
+     * @brief Constructs a Tree that takes ownership of an existing, detached Node.
+     */
+    Tree(AdoptRootTag, Node* root) noexcept : m_root{ root }
+    {
+    }
+
     Node* m_root{ nullptr };
 };
 
@@ -213,6 +386,12 @@ template <typename DataType> class Tree<DataType>::Node
     using reference = DataType&;
     using const_reference = const DataType&;
 
+    /**
+     * @brief The number of children a Node must have before an enabled child index is actually
+     * populated. Below this threshold, a walk of the sibling list is cheaper than hashing.
+     */
+    static constexpr unsigned int DefaultChildIndexThreshold{ 64 };
+
     /**
      * @brief Node default constructs a new Node. All outgoing links from this new node will
      * initialized to a nullptr.
@@ -245,6 +424,9 @@ template <typename DataType> class Tree<DataType>::Node
     {
         DetachFromTree();
 
+        // Dropping the index up front spares each child from having to erase itself from it:
+        DisableChildIndex();
+
         if (m_childCount == 0) {
             m_parent = nullptr;
             m_firstChild = nullptr;
@@ -339,7 +521,7 @@ template <typename DataType> class Tree<DataType>::Node
     /**
      * @brief Swaps all member variables of the left-hand side with that of the right-hand side.
      */
-    friend void swap(Node& lhs, Node& rhs) noexcept(noexcept(swap(lhs.m_data, rhs.m_data)))
+    friend void swap(Node& lhs, Node& rhs) noexcept(std::is_nothrow_swappable_v<DataType>)
     {
         // Enable Argument Dependent Lookup (ADL):
         using std::swap;
@@ -352,6 +534,9 @@ template <typename DataType> class Tree<DataType>::Node
         swap(lhs.m_data, rhs.m_data);
         swap(lhs.m_childCount, rhs.m_childCount);
         swap(lhs.m_visited, rhs.m_visited);
+        swap(lhs.m_childIndex, rhs.m_childIndex);
+        swap(lhs.m_subtreeHash, rhs.m_subtreeHash);
+        swap(lhs.m_isSubtreeHashStale, rhs.m_isSubtreeHashStale);
     }
 
     /**
@@ -362,6 +547,97 @@ template <typename DataType> class Tree<DataType>::Node
         delete this;
     }
 
+    /**
+     * @brief Unlinks the Node, along with all of its descendants, from its parent and siblings.
+     *
+     * @complexity Constant.
+     *
+     * @note The caller assumes ownership of the detached Node, and is responsible for either
+     * re-attaching it somewhere, or for deleting it.
+     *
+     * @returns A pointer to the detached Node.
+     */
+    inline Node* Detach() noexcept
+    {
+        DetachFromTree();
+
+        m_parent = nullptr;
+        m_previousSibling = nullptr;
+        m_nextSibling = nullptr;
+
+        return this;
+    }
+
+    /**
+     * @brief Moves the specified Node, along with all of its descendants, so that it becomes a
+     * child of this Node. If the Node is currently part of a tree, it's unlinked from there first.
+     *
+     * @complexity Constant; no Nodes are copied or allocated.
+     *
+     * @param[in] child               The Node to move. This may not be this Node or one of its
+     *                                ancestors.
+     * @param[in] position            The existing child of this Node that the moved Node should be
+     *                                placed in front of, or nullptr to make it the last child.
+     *
+     * @returns A pointer to the moved Node.
+     */
+    inline Node* Splice(Node& child, Node* position = nullptr) noexcept
+    {
+        assert(!child.IsSelfOrAncestorOf(*this) && "Splicing would create a cycle.");
+        assert((!position || position->m_parent == this) && "Position must be a child.");
+
+        if (&child == position) {
+            return &child;
+        }
+
+        child.Detach();
+
+        if (!position) {
+            return AppendChild(child);
+        }
+
+        if (position == m_firstChild) {
+            return PrependChild(child);
+        }
+
+        child.m_parent = this;
+        InvalidateSubtreeHash();
+
+        child.m_previousSibling = position->m_previousSibling;
+        child.m_nextSibling = position;
+        position->m_previousSibling->m_nextSibling = &child;
+        position->m_previousSibling = &child;
+
+        m_childCount++;
+
+        IndexChild(child);
+
+        return &child;
+    }
+
+    /**
+     * @brief Moves the entire contents of another Tree so that its root becomes a child of this
+     * Node.
+     *
+     * @complexity Constant; no Nodes are copied or allocated.
+     *
+     * @param[in] subtree             The Tree to take ownership of. This Tree will be left without
+     *                                a root.
+     * @param[in] position            The existing child of this Node that the moved root should be
+     *                                placed in front of, or nullptr to make it the last child.
+     *
+     * @returns A pointer to the former root of the moved Tree.
+     */
+    inline Node* Splice(Tree<DataType>&& subtree, Node* position = nullptr) noexcept
+    {
+        assert(subtree.m_root && subtree.m_root != this);
+
+        auto* const root = subtree.m_root;
+        subtree.m_root = nullptr;
+
+        return Splice(*root, position);
+    }
+
     /**
      * @returns The encapsulated data.
      */
@@ -399,13 +675,16 @@ template <typename DataType> class Tree<DataType>::Node
     /**
      * @brief PrependChild will prepend the specified Node as the first child of the Node.
      *
-     * @param[in] child               The new Node to set as the first child of the Node.
+     * @param[in] child               The new Node to set as the first child of the Node. If this
+     *                                Node is already part of a tree, it's unlinked from it first.
      *
      * @returns A pointer to the newly appended child.
      */
     inline Node* PrependChild(Node& child) noexcept
     {
+        child.Detach();
         child.m_parent = this;
+        InvalidateSubtreeHash();
 
         if (!m_firstChild) {
             return AddFirstChild(child);
@@ -419,6 +698,8 @@ template <typename DataType> class Tree<DataType>::Node
 
         m_childCount++;
 
+        IndexChild(child);
+
         return m_firstChild;
     }
 
@@ -432,7 +713,7 @@ template <typename DataType> class Tree<DataType>::Node
      */
     inline Node* PrependChild(const DataType& data)
     {
-        const auto* newNode = new Node{ data };
+        auto* const newNode = new Node{ data };
         return PrependChild(*newNode);
     }
 
@@ -448,13 +729,16 @@ template <typename DataType> class Tree<DataType>::Node
     /**
      * @brief Appends the specified Node as a child of the Node.
      *
-     * @param[in] child               The new Node to set as the last child of the Node.
+     * @param[in] child               The new Node to set as the last child of the Node. If this
+     *                                Node is already part of a tree, it's unlinked from it first.
      *
      * @returns A pointer to the newly appended child.
      */
     inline Node* AppendChild(Node& child) noexcept
     {
+        child.Detach();
         child.m_parent = this;
+        InvalidateSubtreeHash();
 
         if (!m_lastChild) {
             return AddFirstChild(child);
@@ -468,6 +752,8 @@ template <typename DataType> class Tree<DataType>::Node
 
         m_childCount++;
 
+        IndexChild(child);
+
         return m_lastChild;
     }
 
@@ -605,9 +891,232 @@ template <typename DataType> class Tree<DataType>::Node
 
             head->m_parent->m_lastChild = temp;
         }
+
+        if (auto* const index = GetChildIndex()) {
+            try {
+                index->Rebuild(*this);
+            } catch (...) {
+                // The index was left unpopulated, so lookups will walk the sibling list instead.
+            }
+        }
+    }
+
+    /**
+     * @brief Opts this Node into hashed child lookup.
+     *
+     * Once the Node has at least |threshold| children, an open-addressing hash table over the
+     * children is built and then kept up to date as children are appended, prepended, removed, or
+     * sorted. Nodes that never opt in pay nothing beyond a null pointer.
+     *
+     * @note The child index needs to be enabled for the data type through TreeTraits<DataType>.
+     *
+     * @param[in] extractor           A callable that returns the lookup key for a child's data.
+     *                                This type should be equivalent to:
+     *                                   KeyType extractor(const DataType& data);
+     *                                The key type needs to be hashable by `std::hash`.
+     * @param[in] threshold           The fan-out at which the index is populated.
+     */
+    template <typename KeyExtractorType>
+    void EnableChildIndex(
+        KeyExtractorType extractor, unsigned int threshold = DefaultChildIndexThreshold)
+    {
+        static_assert(
+            ChildIndexEnabled, "The child index needs to be enabled through TreeTraits<DataType>.");
+
+        m_childIndex = std::make_unique<KeyedChildIndex<KeyExtractorType>>(
+            std::move(extractor), threshold);
+
+        m_childIndex->Rebuild(*this);
+    }
+
+    /**
+     * @brief Removes the child index, if any.
+     */
+    inline void DisableChildIndex() noexcept
+    {
+        if constexpr (ChildIndexEnabled) {
+            m_childIndex.reset();
+        }
+    }
+
+    /**
+     * @returns True if this Node has opted into hashed child lookup.
+     */
+    inline bool HasChildIndex() const noexcept
+    {
+        return GetChildIndex() != nullptr;
+    }
+
+    /**
+     * @brief Re-hashes all children.
+     *
+     * @note This only needs to be called if the key of a child was changed after it was added.
+     */
+    inline void RebuildChildIndex()
+    {
+        if (auto* const index = GetChildIndex()) {
+            index->Rebuild(*this);
+        }
+    }
+
+    /**
+     * @brief Finds the first child whose key, as produced by the extractor passed to
+     * EnableChildIndex(...), compares equal to |key|.
+     *
+     * @complexity Constant on average if the index is populated, and linear in the number of
+     * children otherwise.
+     *
+     * @param[in] key                 The key to search for. This must either be of the same type
+     *                                as the one returned by the key extractor, or, if the key
+     *                                extractor returns a string type, anything that converts to
+     *                                `std::string_view`; such keys are first converted to the
+     *                                extractor's key type.
+     *
+     * @returns The matching child if it exists, and nullptr otherwise.
+     *
+     * @note Once a child index has been enabled, every lookup compares extracted keys, whether
+     * the table is populated or the fan-out is still below the threshold and the sibling list is
+     * walked instead. A Node without an index has no key extractor, so the data itself then
+     * serves as the key: the children are scanned for one whose data compares equal to |key|,
+     * provided that the data can be compared to the key at all.
+     */
+    template <typename KeyType> Node* FindChild(const KeyType& key) const
+    {
+        if (const auto* const index = GetChildIndex()) {
+            if constexpr (std::is_convertible_v<const KeyType&, std::string_view>) {
+                const std::string_view keyView = key;
+                return index->Find(*this, &key, typeid(KeyType), &keyView);
+            } else {
+                return index->Find(*this, &key, typeid(KeyType), nullptr);
+            }
+        }
+
+        if constexpr (IsComparableToData<KeyType>::value) {
+            return FindChildIf([&](const Node& child) { return child.m_data == key; });
+        } else {
+            return nullptr;
+        }
+    }
+
+    /**
+     * @brief Marks the subtree hash of this Node, and that of all its ancestors, as stale.
+     *
+     * Structural changes made through this class already do this automatically. This only needs
+     * to be called after modifying the data of a Node through GetData() or operator->().
+     *
+     * @complexity Linear in the depth of the Node, but constant if the hash was already stale.
+     *
+     * @note This writes to the ancestors of the Node, so callers that modify different parts of
+     * the same tree concurrently need to serialize their calls, including the ones made on their
+     * behalf by structural changes. Invalidating a Node up front, while holding a lock, ensures
+     * that later calls on it, or on any of its descendants, stop before reaching its ancestors.
+     */
+    inline void InvalidateSubtreeHash() noexcept
+    {
+        for (auto* node = this; node && !node->m_isSubtreeHashStale; node = node->m_parent) {
+            node->m_isSubtreeHashStale = true;
+        }
+    }
+
+    /**
+     * @returns True if the subtree hash needs to be recomputed before it can be relied upon. This
+     * is always the case if subtree hashes aren't enabled through TreeTraits<DataType>.
+     */
+    inline bool IsSubtreeHashStale() const noexcept
+    {
+        return m_isSubtreeHashStale;
+    }
+
+    /**
+     * @returns The cached hash of the data in this Node and all of its descendants. Two subtrees
+     * with equal hashes can be assumed to hold the same data in the same shape, irrespective of the
+     * order in which siblings appear.
+     *
+     * @note The returned value is meaningless if the hash is stale.
+     */
+    inline std::uint64_t GetSubtreeHash() const noexcept
+    {
+        static_assert(
+            SubtreeHashesEnabled,
+            "Subtree hashes need to be enabled through TreeTraits<DataType>.");
+
+        assert(!m_isSubtreeHashStale);
+        return m_subtreeHash;
+    }
+
+    /**
+     * @brief Recomputes the subtree hash of this Node, revisiting only those descendants whose
+     * hashes are stale.
+     *
+     * @param[in] hasher              A callable that hashes the data of a single Node. This type
+     *                                should be equivalent to:
+     *                                   std::uint64_t hasher(const DataType& data);
+     *
+     * @returns The up-to-date subtree hash.
+     */
+    template <typename HasherType> std::uint64_t UpdateSubtreeHash(const HasherType& hasher)
+    {
+        static_assert(
+            SubtreeHashesEnabled,
+            "Subtree hashes need to be enabled through TreeTraits<DataType>.");
+
+        if (!m_isSubtreeHashStale) {
+            return m_subtreeHash;
+        }
+
+        // An explicit stack avoids running out of stack space on very deep trees:
+        std::vector<std::pair<Node*, bool>> stack{ { this, false } };
+
+        while (!stack.empty()) {
+            auto& [node, childrenAreCurrent] = stack.back();
+
+            if (!childrenAreCurrent) {
+                childrenAreCurrent = true;
+
+                auto* const parent = node;
+                for (auto* child = parent->m_firstChild; child; child = child->m_nextSibling) {
+                    if (child->m_isSubtreeHashStale) {
+                        stack.emplace_back(child, false);
+                    }
+                }
+
+                continue;
+            }
+
+            node->RehashFromChildren(hasher);
+            stack.pop_back();
+        }
+
+        return m_subtreeHash;
     }
 
   private:
+    // The child index mixes the hashes of keys the same way that subtree hashes are mixed:
+    friend class ChildIndex;
+
+    static constexpr bool SubtreeHashesEnabled = TreeTraits<DataType>::EnableSubtreeHashes;
+    static constexpr bool ChildIndexEnabled = TreeTraits<DataType>::EnableChildIndex;
+
+    /**
+     * @brief Takes the place of the members backing a feature that TreeTraits<DataType> disabled.
+     * Being a single byte, it typically fits in the padding after the other flags.
+     */
+    struct Disabled
+    {
+    };
+
+    /**
+     * @returns The child index, or nullptr if none was enabled.
+     */
+    ChildIndex* GetChildIndex() const noexcept
+    {
+        if constexpr (ChildIndexEnabled) {
+            return m_childIndex.get();
+        } else {
+            return nullptr;
+        }
+    }
+
     /**
      * @brief Splits the linked-list of sibling nodes in two.
      *
@@ -702,6 +1211,100 @@ template <typename DataType> class Tree<DataType>::Node
         return head;
     }
 
+    /**
+     * @returns True if this Node is the specified Node, or one of its ancestors.
+     */
+    bool IsSelfOrAncestorOf(const Node& node) const noexcept
+    {
+        for (const auto* ancestor = &node; ancestor; ancestor = ancestor->m_parent) {
+            if (ancestor == this) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    template <typename KeyType, typename = void> struct IsComparableToData : std::false_type
+    {
+    };
+
+    template <typename KeyType>
+    struct IsComparableToData<
+        KeyType,
+        std::void_t<decltype(std::declval<const DataType&>() == std::declval<const KeyType&>())>>
+        : std::true_type
+    {
+    };
+
+    /**
+     * @returns The first child for which |predicate| returns true, or nullptr if there is none.
+     * This is the one sibling walk behind FindChild(...), whether or not an index is enabled.
+     */
+    template <typename PredicateType> Node* FindChildIf(const PredicateType& predicate) const
+    {
+        for (auto* child = m_firstChild; child; child = child->m_nextSibling) {
+            if (predicate(*child)) {
+                return child;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * @brief Records a newly linked |child| in the child index, if there is one.
+     *
+     * Should the key extractor throw, the index is left unpopulated, and lookups will walk the
+     * sibling list instead; the structural change itself has already been made by then.
+     */
+    void IndexChild(Node& child) noexcept
+    {
+        auto* const index = GetChildIndex();
+        if (!index) {
+            return;
+        }
+
+        try {
+            index->Insert(*this, child);
+        } catch (...) {
+        }
+    }
+
+    /**
+     * @brief A 64-bit finalizer with good avalanche properties (borrowed from SplitMix64).
+     */
+    static constexpr std::uint64_t MixHash(std::uint64_t value) noexcept
+    {
+        value ^= value >> 30;
+        value *= 0xBF58476D1CE4E5B9ull;
+        value ^= value >> 27;
+        value *= 0x94D049BB133111EBull;
+        value ^= value >> 31;
+
+        return value;
+    }
+
+    /**
+     * @brief Computes the subtree hash of this Node under the assumption that the hashes of all
+     * children are current.
+     *
+     * Child hashes are combined by summation so that the result is independent of sibling order.
+     */
+    template <typename HasherType> void RehashFromChildren(const HasherType& hasher)
+    {
+        std::uint64_t childSum = m_childCount;
+        for (const auto* child = m_firstChild; child; child = child->m_nextSibling) {
+            assert(!child->m_isSubtreeHashStale);
+            childSum += MixHash(child->m_subtreeHash + 0x9E3779B97F4A7C15ull);
+        }
+
+        const auto dataHash = static_cast<std::uint64_t>(hasher(m_data));
+
+        m_subtreeHash = MixHash(dataHash ^ MixHash(childSum));
+        m_isSubtreeHashStale = false;
+    }
+
     /**
      * @brief Helper function to make it easier to add the first descendant.
      *
@@ -718,6 +1321,8 @@ template <typename DataType> class Tree<DataType>::Node
 
         m_childCount++;
 
+        IndexChild(child);
+
         return m_firstChild;
     }
 
@@ -730,6 +1335,12 @@ template <typename DataType> class Tree<DataType>::Node
      */
     void Copy(const Node& source, Node& sink)
     {
+        if (const auto* const index = source.GetChildIndex()) {
+            if constexpr (ChildIndexEnabled) {
+                sink.m_childIndex = index->CloneEmpty();
+            }
+        }
+
         if (!source.HasChildren()) {
             return;
         }
@@ -772,6 +1383,16 @@ template <typename DataType> class Tree<DataType>::Node
             return this;
         }
 
+        if (auto* const index = m_parent->GetChildIndex()) {
+            try {
+                index->Erase(*this);
+            } catch (...) {
+                // The index was cleared rather than left pointing at this Node.
+            }
+        }
+
+        m_parent->InvalidateSubtreeHash();
+
         if (m_parent->m_firstChild == m_parent->m_lastChild) {
             m_parent->m_firstChild = nullptr;
             m_parent->m_lastChild = nullptr;
@@ -799,6 +1420,321 @@ template <typename DataType> class Tree<DataType>::Node
     unsigned int m_childCount{ 0 };
 
     bool m_visited{ false };
+    bool m_isSubtreeHashStale{ true };
+
+    std::conditional_t<ChildIndexEnabled, std::unique_ptr<ChildIndex>, Disabled> m_childIndex{};
+
+    std::conditional_t<SubtreeHashesEnabled, std::uint64_t, Disabled> m_subtreeHash{};
+};
+
+/**
+ * @brief An open-addressing hash table over the direct descendants of a single Node.
+ *
+ * The table uses linear probing and backward-shift deletion, and stores the full hash of each
+ * child alongside it so that neither probing nor growing the table needs to re-extract any keys.
+ * Until the owning Node reaches the configured fan-out threshold, the table remains unallocated.
+ */
+template <typename DataType> class Tree<DataType>::ChildIndex
+{
+  public:
+    explicit ChildIndex(unsigned int threshold) noexcept : m_threshold{ threshold }
+    {
+    }
+
+    ChildIndex(const ChildIndex&) = delete;
+    ChildIndex& operator=(const ChildIndex&) = delete;
+
+    virtual ~ChildIndex() = default;
+
+    /**
+     * @returns A new, unpopulated index that uses the same key extractor and threshold.
+     */
+    virtual std::unique_ptr<ChildIndex> CloneEmpty() const = 0;
+
+    /**
+     * @returns The first child of |parent| that matches the type-erased |key|.
+     *
+     * @param[in] keyView             The key as a string, if it converts to one, so that it can
+     *                                still be matched when its type differs from the key type.
+     */
+    virtual Node* Find(
+        const Node& parent, const void* key, const std::type_info& keyType,
+        const std::string_view* keyView) const = 0;
+
+    /**
+     * @brief Records a newly linked |child| of |parent|.
+     *
+     * @note If the key extractor throws, the index is left unpopulated before rethrowing.
+     */
+    void Insert(const Node& parent, Node& child)
+    {
+        if (m_slots.empty()) {
+            if (parent.GetChildCount() >= m_threshold) {
+                Rebuild(parent);
+            }
+
+            return;
+        }
+
+        if (NeedsToGrow(m_occupied + 1)) {
+            Rebuild(parent);
+            return;
+        }
+
+        try {
+            Place(child, HashOf(child));
+        } catch (...) {
+            Clear();
+            throw;
+        }
+    }
+
+    /**
+     * @brief Forgets about |child|, if it was indexed.
+     *
+     * @note If the key extractor throws, the index is left unpopulated before rethrowing.
+     */
+    void Erase(const Node& child)
+    {
+        if (m_slots.empty()) {
+            return;
+        }
+
+        std::size_t hole;
+        try {
+            hole = LocateSlot(child);
+        } catch (...) {
+            Clear();
+            throw;
+        }
+
+        const auto mask = m_slots.size() - 1;
+        if (hole == m_slots.size()) {
+            return;
+        }
+
+        // Backward-shift deletion keeps every probe sequence unbroken without tombstones:
+        auto next = (hole + 1) & mask;
+        while (m_slots[next].node) {
+            const auto home = m_slots[next].hash & mask;
+            const auto distanceToHole = (hole - home) & mask;
+            const auto distanceToNext = (next - home) & mask;
+
+            if (distanceToHole < distanceToNext) {
+                m_slots[hole] = m_slots[next];
+                hole = next;
+            }
+
+            next = (next + 1) & mask;
+        }
+
+        m_slots[hole] = Slot{};
+        --m_occupied;
+
+        // Since a populated table holds every child, it can go once the parent falls below the
+        // threshold; Insert(...) repopulates it when the parent grows past the threshold again:
+        if (m_occupied < m_threshold) {
+            Clear();
+        }
+    }
+
+    /**
+     * @brief Discards and then re-hashes all children of |parent|.
+     *
+     * If the table cannot be allocated, the index is simply left unpopulated, and lookups will
+     * fall back to walking the sibling list. The same goes for a key extractor that throws,
+     * except that the exception is then rethrown.
+     */
+    void Rebuild(const Node& parent)
+    {
+        if (parent.GetChildCount() < m_threshold) {
+            Clear();
+            return;
+        }
+
+        try {
+            if (NeedsToGrow(parent.GetChildCount())) {
+                std::size_t capacity = 16;
+                while (capacity < 2 * static_cast<std::size_t>(parent.GetChildCount())) {
+                    capacity *= 2;
+                }
+
+                m_slots.assign(capacity, Slot{});
+            } else {
+                std::fill(std::begin(m_slots), std::end(m_slots), Slot{});
+            }
+        } catch (const std::bad_alloc&) {
+            Clear();
+            return;
+        }
+
+        m_occupied = 0;
+
+        try {
+            for (auto* child = parent.GetFirstChild(); child; child = child->GetNextSibling()) {
+                Place(*child, HashOf(*child));
+            }
+        } catch (...) {
+            Clear();
+            throw;
+        }
+    }
+
+  protected:
+    /**
+     * @returns The hash of the key associated with |node|.
+     */
+    virtual std::size_t HashOf(const Node& node) const = 0;
+
+    /**
+     * @brief Spreads a key's hash across all bits before the table masks off its low bits; for
+     * integers, `std::hash` is typically the identity function, which would cluster sequential
+     * keys into neighbouring slots.
+     */
+    static std::size_t MixHash(std::size_t hash) noexcept
+    {
+        return static_cast<std::size_t>(Node::MixHash(hash));
+    }
+
+    /**
+     * @returns The first child of |parent| for which |predicate| returns true, using the table
+     * when it's populated and the sibling list otherwise.
+     */
+    template <typename PredicateType>
+    Node* Probe(const Node& parent, std::size_t hash, const PredicateType& predicate) const
+    {
+        if (m_slots.empty()) {
+            return parent.FindChildIf(predicate);
+        }
+
+        const auto mask = m_slots.size() - 1;
+        for (auto index = hash & mask; m_slots[index].node; index = (index + 1) & mask) {
+            if (m_slots[index].hash == hash && predicate(*m_slots[index].node)) {
+                return m_slots[index].node;
+            }
+        }
+
+        return nullptr;
+    }
+
+    const unsigned int m_threshold;
+
+  private:
+    struct Slot
+    {
+        Node* node{ nullptr };
+        std::size_t hash{ 0 };
+    };
+
+    /**
+     * @returns True if the table would exceed a load factor of one half with |count| entries.
+     */
+    bool NeedsToGrow(std::size_t count) const noexcept
+    {
+        return 2 * count > m_slots.size();
+    }
+
+    void Clear() noexcept
+    {
+        m_slots.clear();
+        m_slots.shrink_to_fit();
+        m_occupied = 0;
+    }
+
+    void Place(Node& node, std::size_t hash) noexcept
+    {
+        const auto mask = m_slots.size() - 1;
+
+        auto index = hash & mask;
+        while (m_slots[index].node) {
+            index = (index + 1) & mask;
+        }
+
+        m_slots[index] = Slot{ &node, hash };
+        ++m_occupied;
+    }
+
+    /**
+     * @returns The slot holding |node|, or the size of the table if it isn't present.
+     */
+    std::size_t LocateSlot(const Node& node) const
+    {
+        const auto mask = m_slots.size() - 1;
+        for (auto index = HashOf(node) & mask; m_slots[index].node; index = (index + 1) & mask) {
+            if (m_slots[index].node == &node) {
+                return index;
+            }
+        }
+
+        // The key may have been modified since the node was indexed, in which case its current
+        // hash will lead us astray:
+        const auto match = std::find_if(
+            std::begin(m_slots), std::end(m_slots),
+            [&](const Slot& slot) noexcept { return slot.node == &node; });
+
+        return static_cast<std::size_t>(std::distance(std::begin(m_slots), match));
+    }
+
+    std::vector<Slot> m_slots;
+
+    std::size_t m_occupied{ 0 };
+};
+
+/**
+ * @brief The ChildIndex specialization that knows how to extract and hash a key of a particular
+ * type.
+ */
+template <typename DataType>
+template <typename KeyExtractorType>
+class Tree<DataType>::KeyedChildIndex final : public Tree<DataType>::ChildIndex
+{
+  public:
+    using KeyType =
+        std::decay_t<std::invoke_result_t<const KeyExtractorType&, const DataType&>>;
+
+    KeyedChildIndex(KeyExtractorType extractor, unsigned int threshold)
+        : ChildIndex{ threshold }, m_extractor{ std::move(extractor) }
+    {
+    }
+
+    std::unique_ptr<ChildIndex> CloneEmpty() const override
+    {
+        return std::make_unique<KeyedChildIndex>(m_extractor, this->m_threshold);
+    }
+
+    Node* Find(
+        const Node& parent, const void* key, const std::type_info& keyType,
+        const std::string_view* keyView) const override
+    {
+        if (keyType == typeid(KeyType)) {
+            return FindKey(parent, *static_cast<const KeyType*>(key));
+        }
+
+        if constexpr (std::is_constructible_v<KeyType, std::string_view>) {
+            if (keyView) {
+                return FindKey(parent, KeyType{ *keyView });
+            }
+        }
+
+        assert(!"Key type doesn't match the key extractor.");
+        return nullptr;
+    }
+
+  protected:
+    std::size_t HashOf(const Node& node) const override
+    {
+        return this->MixHash(std::hash<KeyType>{}(m_extractor(node.GetData())));
+    }
+
+  private:
+    Node* FindKey(const Node& parent, const KeyType& key) const
+    {
+        return this->Probe(parent, this->MixHash(std::hash<KeyType>{}(key)), [&](const Node& node) {
+            return m_extractor(node.GetData()) == key;
+        });
+    }
+
+    KeyExtractorType m_extractor;
 };
 
 /**
@@ -0,0 +1,519 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tree.h"
+#include "tree_serialization.h"
+
+namespace TreeUtilities
+{
+namespace Detail
+{
+constexpr char JournalMagic[4] = { 'T', 'J', 'N', 'L' };
+constexpr std::uint32_t JournalVersion{ 1 };
+
+enum class JournalOperation : std::uint8_t
+{
+    Append = 1,
+    Prepend = 2,
+    Delete = 3,
+    SetData = 4,
+    Sort = 5
+};
+
+/**
+ * @returns The child at the specified position, walking from whichever end is closest, or nullptr
+ * if there's no such child.
+ */
+template <typename DataType>
+typename Tree<DataType>::Node*
+GetChildAt(const typename Tree<DataType>::Node& parent, std::uint64_t index) noexcept
+{
+    const std::uint64_t childCount = parent.GetChildCount();
+    if (index >= childCount) {
+        return nullptr;
+    }
+
+    if (index < childCount / 2) {
+        auto* child = parent.GetFirstChild();
+        for (; index > 0; --index) {
+            child = child->GetNextSibling();
+        }
+
+        return child;
+    }
+
+    auto* child = parent.GetLastChild();
+    for (auto remaining = childCount - 1 - index; remaining > 0; --remaining) {
+        child = child->GetPreviousSibling();
+    }
+
+    return child;
+}
+} // namespace Detail
+
+/**
+ * @brief Records mutations of a tree as compact binary records, so that a tree can be persisted
+ * incrementally.
+ *
+ * Mutations that should be journaled are made through the Journal, rather than directly on the
+ * Nodes. The Journal applies each mutation to the tree and appends a record describing it.
+ * Records identify Nodes by their path of sibling indices from the root, so that they can later be
+ * replayed onto a snapshot of the tree, as written by Save(...), using ReplayJournal(...).
+ *
+ * Checkpointing a tree then only requires flushing the journal, which costs time proportional to
+ * the number of mutations, rather than to the size of the tree. Once the journal has grown large,
+ * it can be folded into a new snapshot using CompactJournal(...).
+ *
+ * To build those paths, the Journal remembers the sibling index of every child of each Node that a
+ * recorded path passed through. The first record that passes through a Node indexes all of its
+ * children, after which appending, prepending, or deleting the first or last child keeps the
+ * indices current in constant time. Deleting any other child, which shifts the indices of its
+ * later siblings, makes the next record that passes through the parent index its children anew.
+ *
+ * @note Mutations that bypass the Journal will make subsequent records refer to the wrong Nodes.
+ */
+template <typename DataType, typename CodecType = DefaultCodec<DataType>> class Journal
+{
+  public:
+    using NodeType = typename Tree<DataType>::Node;
+
+    /**
+     * @brief Attaches a new journal to the specified tree, and writes the journal's header.
+     *
+     * @param[in] tree                The tree whose mutations will be journaled.
+     * @param[out] stream             The stream to write records to. This should be opened in
+     *                                binary mode.
+     * @param[in] codec               Encodes the data stored in each Node.
+     */
+    Journal(Tree<DataType>& tree, std::ostream& stream, CodecType codec = {})
+        : m_tree{ tree }, m_stream{ stream }, m_writer{ stream }, m_codec{ std::move(codec) }
+    {
+        m_writer.WriteBytes(Detail::JournalMagic, sizeof(Detail::JournalMagic));
+        m_writer.WriteFixed(Detail::JournalVersion);
+        m_writer.WriteFixed(Detail::CodecVersion<CodecType>::value);
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    /**
+     * @brief Appends a new child to the specified Node, and records the mutation.
+     *
+     * @returns A pointer to the newly appended child.
+     */
+    NodeType* AppendChild(NodeType& parent, DataType data)
+    {
+        auto* const child = parent.AppendChild(std::move(data));
+        RecordWithData(Detail::JournalOperation::Append, parent, child->GetData());
+
+        if (auto* const siblings = FindSiblingIndices(parent)) {
+            siblings->positions.emplace(
+                child, siblings->firstPosition + (parent.GetChildCount() - 1));
+        }
+
+        return child;
+    }
+
+    /**
+     * @brief Prepends a new child to the specified Node, and records the mutation.
+     *
+     * @returns A pointer to the newly prepended child.
+     */
+    NodeType* PrependChild(NodeType& parent, DataType data)
+    {
+        auto* const child = parent.PrependChild(std::move(data));
+        RecordWithData(Detail::JournalOperation::Prepend, parent, child->GetData());
+
+        if (auto* const siblings = FindSiblingIndices(parent)) {
+            siblings->positions.emplace(child, --siblings->firstPosition);
+        }
+
+        return child;
+    }
+
+    /**
+     * @brief Deletes the specified Node, along with all of its descendants, and records the
+     * mutation. The root cannot be deleted.
+     */
+    void DeleteFromTree(NodeType& node)
+    {
+        assert(node.GetParent() && "The root cannot be deleted.");
+
+        WriteOperation(Detail::JournalOperation::Delete, node);
+        ForgetSubtree(node);
+        node.DeleteFromTree();
+
+        ++m_recordCount;
+    }
+
+    /**
+     * @brief Replaces the data of the specified Node, and records the mutation.
+     */
+    void SetData(NodeType& node, DataType data)
+    {
+        node.GetData() = std::move(data);
+        node.InvalidateSubtreeHash();
+
+        RecordWithData(Detail::JournalOperation::SetData, node, node.GetData());
+    }
+
+    /**
+     * @brief Sorts the children of the specified Node, and records the mutation.
+     *
+     * Since the comparator cannot be persisted, the record stores the resulting permutation of the
+     * children instead. The size of the record is therefore linear in the number of children.
+     *
+     * @see Tree::Node::SortChildren(...)
+     */
+    template <typename ComparatorType>
+    void SortChildren(NodeType& parent, const ComparatorType& comparator)
+    {
+        std::unordered_map<const NodeType*, std::uint64_t> originalIndices;
+        originalIndices.reserve(parent.GetChildCount());
+
+        std::uint64_t index{ 0 };
+        for (const auto* child = parent.GetFirstChild(); child; child = child->GetNextSibling()) {
+            originalIndices.emplace(child, index++);
+        }
+
+        parent.SortChildren(comparator);
+
+        WriteOperation(Detail::JournalOperation::Sort, parent);
+        m_writer.WriteVarint(parent.GetChildCount());
+
+        auto& siblings = m_siblingIndices[&parent];
+        siblings.positions.clear();
+        siblings.firstPosition = 0;
+
+        std::int64_t position{ 0 };
+        for (const auto* child = parent.GetFirstChild(); child; child = child->GetNextSibling()) {
+            m_writer.WriteVarint(originalIndices[child]);
+            siblings.positions.emplace(child, position++);
+        }
+
+        ++m_recordCount;
+    }
+
+    /**
+     * @brief Hands all buffered records to the underlying stream, and flushes it. After this
+     * returns successfully, the journal reflects every mutation made so far.
+     *
+     * @returns True if the underlying stream is still in a good state.
+     */
+    bool Flush()
+    {
+        return m_writer.Flush() && m_stream.flush().good();
+    }
+
+    /**
+     * @returns The tree whose mutations are being journaled.
+     */
+    Tree<DataType>& GetTree() const noexcept
+    {
+        return m_tree;
+    }
+
+    /**
+     * @returns The number of mutations that have been recorded.
+     */
+    std::size_t GetRecordCount() const noexcept
+    {
+        return m_recordCount;
+    }
+
+  private:
+    /**
+     * @brief The sibling indices of the children of a single Node. Each child's index is stored as
+     * a position relative to that of the first child, so that prepending a child, or deleting the
+     * first one, doesn't require renumbering the others.
+     */
+    struct SiblingIndices
+    {
+        std::unordered_map<const NodeType*, std::int64_t> positions;
+        std::int64_t firstPosition{ 0 };
+    };
+
+    /**
+     * @returns The sibling indices of the children of |parent|, or nullptr if they aren't known.
+     */
+    SiblingIndices* FindSiblingIndices(const NodeType& parent) noexcept
+    {
+        const auto itr = m_siblingIndices.find(&parent);
+        return itr != std::end(m_siblingIndices) ? &itr->second : nullptr;
+    }
+
+    /**
+     * @returns The position of the Node among its siblings, indexing all of its siblings first if
+     * they aren't indexed yet.
+     *
+     * @complexity Constant on average once the siblings are indexed, and linear in the number of
+     * siblings otherwise.
+     */
+    std::uint64_t GetSiblingIndex(const NodeType& node)
+    {
+        const auto& parent = *node.GetParent();
+        auto& siblings = m_siblingIndices[&parent];
+
+        if (siblings.positions.empty()) {
+            siblings.positions.reserve(parent.GetChildCount());
+            siblings.firstPosition = 0;
+
+            std::int64_t position{ 0 };
+            for (const auto* child = parent.GetFirstChild(); child;
+                 child = child->GetNextSibling()) {
+                siblings.positions.emplace(child, position++);
+            }
+        }
+
+        assert(siblings.positions.count(&node) && "The Node was modified outside of the Journal.");
+        return static_cast<std::uint64_t>(siblings.positions[&node] - siblings.firstPosition);
+    }
+
+    /**
+     * @brief Drops every sibling index that the deletion of |node| would invalidate, including
+     * those that are keyed by the Nodes being deleted, since their addresses may be reused.
+     */
+    void ForgetSubtree(const NodeType& node)
+    {
+        const auto& parent = *node.GetParent();
+        if (auto* const siblings = FindSiblingIndices(parent)) {
+            if (&node == parent.GetFirstChild()) {
+                siblings->positions.erase(&node);
+                ++siblings->firstPosition;
+            } else if (&node == parent.GetLastChild()) {
+                siblings->positions.erase(&node);
+            } else {
+                m_siblingIndices.erase(&parent);
+            }
+        }
+
+        if (m_siblingIndices.empty()) {
+            return;
+        }
+
+        std::vector<const NodeType*> stack{ &node };
+        while (!stack.empty()) {
+            const auto* const current = stack.back();
+            stack.pop_back();
+
+            // A Node without children has no sibling indices worth dropping:
+            if (!current->HasChildren()) {
+                continue;
+            }
+
+            m_siblingIndices.erase(current);
+
+            for (const auto* child = current->GetFirstChild(); child;
+                 child = child->GetNextSibling()) {
+                stack.emplace_back(child);
+            }
+        }
+    }
+
+    void RecordWithData(
+        Detail::JournalOperation operation, const NodeType& node, const DataType& data)
+    {
+        WriteOperation(operation, node);
+        m_codec.Encode(m_writer, data);
+
+        ++m_recordCount;
+    }
+
+    void WriteOperation(Detail::JournalOperation operation, const NodeType& node)
+    {
+        m_path.clear();
+
+        const auto* current = &node;
+        for (; current->GetParent(); current = current->GetParent()) {
+            m_path.emplace_back(GetSiblingIndex(*current));
+        }
+
+        assert(current == m_tree.GetRoot() && "The Node must be part of the journaled tree.");
+
+        m_writer.WriteFixed(static_cast<std::uint8_t>(operation));
+        m_writer.WriteVarint(m_path.size());
+
+        for (auto index = m_path.rbegin(); index != m_path.rend(); ++index) {
+            m_writer.WriteVarint(*index);
+        }
+    }
+
+    Tree<DataType>& m_tree;
+    std::ostream& m_stream;
+
+    BinaryWriter m_writer;
+    CodecType m_codec;
+
+    // Reused between records, so that recording a mutation doesn't usually allocate:
+    std::vector<std::uint64_t> m_path;
+
+    // Keyed by parent; see SiblingIndices:
+    std::unordered_map<const NodeType*, SiblingIndices> m_siblingIndices;
+
+    std::size_t m_recordCount{ 0 };
+};
+
+/**
+ * @brief Applies the mutations recorded by a Journal to a tree.
+ *
+ * The tree needs to be in the same state that the journaled tree was in when the Journal was
+ * attached, which is typically achieved by loading the snapshot that was saved at that time.
+ *
+ * @param[in, out] tree           The tree to apply the recorded mutations to.
+ * @param[in] stream              The stream to read records from. This should be opened in binary
+ *                                mode.
+ * @param[in] codec               Decodes the data stored in each Node. This needs to mirror the
+ *                                codec that was used to write the journal.
+ *
+ * @returns True if every record was applied. If the journal was malformed or truncated, or if it
+ * doesn't match the tree, false is returned, and only the records preceding the offending record
+ * will have been applied.
+ */
+template <typename DataType, typename CodecType = DefaultCodec<DataType>>
+bool ReplayJournal(Tree<DataType>& tree, std::istream& stream, const CodecType& codec = {})
+{
+    using NodeType = typename Tree<DataType>::Node;
+
+    BinaryReader reader{ stream };
+
+    char magic[sizeof(Detail::JournalMagic)] = {};
+    reader.ReadBytes(magic, sizeof(magic));
+
+    const auto version = reader.ReadFixed<std::uint32_t>();
+    const auto codecVersion = reader.ReadFixed<std::uint32_t>();
+    if (!reader.IsGood() || std::memcmp(magic, Detail::JournalMagic, sizeof(magic)) != 0 ||
+        version != Detail::JournalVersion ||
+        codecVersion != Detail::CodecVersion<CodecType>::value) {
+        return false;
+    }
+
+    std::vector<NodeType*> children;
+    std::vector<std::uint64_t> order;
+    std::vector<bool> isTaken;
+
+    while (true) {
+        std::uint8_t operation{ 0 };
+        if (!reader.ReadBytes(&operation, sizeof(operation))) {
+            // Running out of input in between records simply marks the end of the journal:
+            return true;
+        }
+
+        auto* node = tree.GetRoot();
+        for (auto depth = reader.ReadVarint(); depth > 0 && node && reader.IsGood(); --depth) {
+            node = Detail::GetChildAt<DataType>(*node, reader.ReadVarint());
+        }
+
+        if (!node || !reader.IsGood()) {
+            return false;
+        }
+
+        switch (static_cast<Detail::JournalOperation>(operation)) {
+            case Detail::JournalOperation::Append: {
+                auto data = codec.Decode(reader);
+                if (!reader.IsGood()) {
+                    return false;
+                }
+
+                node->AppendChild(std::move(data));
+                break;
+            }
+            case Detail::JournalOperation::Prepend: {
+                auto data = codec.Decode(reader);
+                if (!reader.IsGood()) {
+                    return false;
+                }
+
+                node->PrependChild(std::move(data));
+                break;
+            }
+            case Detail::JournalOperation::Delete: {
+                if (!node->GetParent()) {
+                    return false;
+                }
+
+                node->DeleteFromTree();
+                break;
+            }
+            case Detail::JournalOperation::SetData: {
+                auto data = codec.Decode(reader);
+                if (!reader.IsGood()) {
+                    return false;
+                }
+
+                node->GetData() = std::move(data);
+                node->InvalidateSubtreeHash();
+                break;
+            }
+            case Detail::JournalOperation::Sort: {
+                const auto childCount = reader.ReadVarint();
+                if (!reader.IsGood() || childCount != node->GetChildCount()) {
+                    return false;
+                }
+
+                // The entire permutation is read and validated before any child is moved, so that
+                // a malformed record doesn't leave the children partially reordered:
+                order.clear();
+                isTaken.assign(static_cast<std::size_t>(childCount), false);
+
+                for (std::uint64_t index = 0; index < childCount; ++index) {
+                    const auto originalIndex = reader.ReadVarint();
+                    if (!reader.IsGood() || originalIndex >= childCount || isTaken[originalIndex]) {
+                        return false;
+                    }
+
+                    isTaken[originalIndex] = true;
+                    order.emplace_back(originalIndex);
+                }
+
+                children.clear();
+                for (auto* child = node->GetFirstChild(); child; child = child->GetNextSibling()) {
+                    children.emplace_back(child);
+                }
+
+                // Re-appending every child in its recorded order reproduces the sort:
+                for (const auto originalIndex : order) {
+                    node->AppendChild(*children[originalIndex]);
+                }
+
+                break;
+            }
+            default: {
+                return false;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Folds a journal into the snapshot it was recorded against, producing a new snapshot.
+ *
+ * @param[in] snapshot            The stream to read the base snapshot from, as written by
+ *                                Save(...).
+ * @param[in] journal             The stream to read the journal from.
+ * @param[out] output             The stream to write the new snapshot to.
+ * @param[in] codec               Encodes and decodes the data stored in each Node.
+ *
+ * @returns True if the new snapshot was written successfully.
+ */
+template <typename DataType, typename CodecType = DefaultCodec<DataType>>
+bool CompactJournal(
+    std::istream& snapshot, std::istream& journal, std::ostream& output,
+    const CodecType& codec = {})
+{
+    auto tree = Load<DataType>(snapshot, codec);
+    if (!tree || !ReplayJournal(*tree, journal, codec)) {
+        return false;
+    }
+
+    return Save(*tree, output, codec);
+}
+} // namespace TreeUtilities
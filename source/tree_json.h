@@ -0,0 +1,1134 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tree.h"
+
+namespace TreeUtilities
+{
+/**
+ * @brief The two JSON layouts supported by WriteJson(...) and ReadJson(...).
+ */
+enum class JsonLayout
+{
+    // A single JSON document, in which every Node is an object of the following shape:
+    //
+    //    { "data": ..., "children": [ ... ] }
+    //
+    // The "children" array is omitted for leaf Nodes.
+    Nested,
+
+    // One JSON object per line (NDJSON), with every Node listed in pre-order:
+    //
+    //    { "id": 1, "parent": 0, "data": ... }
+    //
+    // The parent of the root is null.
+    NewlineDelimited
+};
+
+/**
+ * @brief A buffered, streaming JSON writer.
+ *
+ * Separators are inserted automatically, so a sequence of calls such as BeginObject(), Key(...),
+ * String(...), Key(...), Integer(...), EndObject() produces well-formed output. Only the state of
+ * the currently open objects and arrays is retained, and no string is allocated per value.
+ */
+class JsonWriter
+{
+  public:
+    explicit JsonWriter(std::ostream& stream)
+        : m_stream{ stream }, m_buffer{ std::make_unique<char[]>(BufferSize) }
+    {
+    }
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    /**
+     * @brief Flushes any remaining buffered output to the underlying stream.
+     */
+    ~JsonWriter()
+    {
+        Flush();
+    }
+
+    void BeginObject()
+    {
+        BeginValue();
+        Put('{');
+        m_hasElements.push_back(false);
+    }
+
+    void EndObject()
+    {
+        m_hasElements.pop_back();
+        Put('}');
+    }
+
+    void BeginArray()
+    {
+        BeginValue();
+        Put('[');
+        m_hasElements.push_back(false);
+    }
+
+    void EndArray()
+    {
+        m_hasElements.pop_back();
+        Put(']');
+    }
+
+    /**
+     * @brief Writes the key of the next member of the current object.
+     */
+    void Key(std::string_view key)
+    {
+        BeginValue();
+        WriteQuoted(key);
+        Put(':');
+
+        m_isAfterKey = true;
+    }
+
+    /**
+     * @brief Writes a string value, escaping it as necessary.
+     */
+    void String(std::string_view value)
+    {
+        BeginValue();
+        WriteQuoted(value);
+    }
+
+    /**
+     * @brief Writes an integral value.
+     */
+    template <typename IntegerType> void Integer(IntegerType value)
+    {
+        static_assert(std::is_integral_v<IntegerType>, "Only integers are supported.");
+
+        BeginValue();
+
+        char digits[std::numeric_limits<IntegerType>::digits10 + 2];
+        const auto [end, error] = std::to_chars(std::begin(digits), std::end(digits), value);
+        Write(digits, static_cast<std::size_t>(end - digits));
+    }
+
+    /**
+     * @brief Writes a floating point value, using the shortest representation that round-trips.
+     * Since JSON cannot represent infinities or NaN, those are written as null.
+     */
+    void Number(double value)
+    {
+        if (!std::isfinite(value)) {
+            Null();
+            return;
+        }
+
+        BeginValue();
+
+        char digits[32];
+        const auto [end, error] = std::to_chars(std::begin(digits), std::end(digits), value);
+        Write(digits, static_cast<std::size_t>(end - digits));
+    }
+
+    void Bool(bool value)
+    {
+        BeginValue();
+
+        if (value) {
+            Write("true", 4);
+        } else {
+            Write("false", 5);
+        }
+    }
+
+    void Null()
+    {
+        BeginValue();
+        Write("null", 4);
+    }
+
+    /**
+     * @brief Ends the current line. This is used to delimit top-level values in NDJSON.
+     */
+    void NewLine()
+    {
+        Put('\n');
+    }
+
+    /**
+     * @brief Hands all buffered output to the underlying stream.
+     *
+     * @returns True if the underlying stream is still in a good state.
+     */
+    bool Flush()
+    {
+        if (m_bufferedSize > 0) {
+            m_stream.write(m_buffer.get(), static_cast<std::streamsize>(m_bufferedSize));
+            m_bufferedSize = 0;
+        }
+
+        return m_stream.good();
+    }
+
+  private:
+    void BeginValue()
+    {
+        if (m_isAfterKey) {
+            m_isAfterKey = false;
+            return;
+        }
+
+        if (!m_hasElements.empty()) {
+            if (m_hasElements.back()) {
+                Put(',');
+            }
+
+            m_hasElements.back() = true;
+        }
+    }
+
+    void WriteQuoted(std::string_view value)
+    {
+        static constexpr char hexDigits[] = "0123456789abcdef";
+
+        Put('"');
+
+        // Characters that don't need escaping are copied in runs, rather than one by one:
+        std::size_t runStart = 0;
+        for (std::size_t index = 0; index < value.size(); ++index) {
+            const auto character = static_cast<unsigned char>(value[index]);
+            if (character >= 0x20 && character != '"' && character != '\\') {
+                continue;
+            }
+
+            Write(value.data() + runStart, index - runStart);
+            runStart = index + 1;
+
+            switch (character) {
+                case '"':
+                    Write("\\\"", 2);
+                    break;
+                case '\\':
+                    Write("\\\\", 2);
+                    break;
+                case '\b':
+                    Write("\\b", 2);
+                    break;
+                case '\f':
+                    Write("\\f", 2);
+                    break;
+                case '\n':
+                    Write("\\n", 2);
+                    break;
+                case '\r':
+                    Write("\\r", 2);
+                    break;
+                case '\t':
+                    Write("\\t", 2);
+                    break;
+                default: {
+                    const char escape[] = { '\\', 'u', '0', '0', hexDigits[character >> 4],
+                                            hexDigits[character & 0xF] };
+                    Write(escape, sizeof(escape));
+                }
+            }
+        }
+
+        Write(value.data() + runStart, value.size() - runStart);
+
+        Put('"');
+    }
+
+    void Put(char character)
+    {
+        if (m_bufferedSize == BufferSize) {
+            Flush();
+        }
+
+        m_buffer[m_bufferedSize++] = character;
+    }
+
+    void Write(const char* data, std::size_t size)
+    {
+        if (m_bufferedSize + size > BufferSize) {
+            Flush();
+
+            if (size > BufferSize) {
+                m_stream.write(data, static_cast<std::streamsize>(size));
+                return;
+            }
+        }
+
+        std::memcpy(m_buffer.get() + m_bufferedSize, data, size);
+        m_bufferedSize += size;
+    }
+
+    static constexpr std::size_t BufferSize{ 64 * 1024 };
+
+    std::ostream& m_stream;
+
+    std::unique_ptr<char[]> m_buffer;
+    std::size_t m_bufferedSize{ 0 };
+
+    // One entry per open object or array, recording whether it already has any elements:
+    std::vector<bool> m_hasElements;
+    bool m_isAfterKey{ false };
+};
+
+/**
+ * @brief A buffered, streaming (pull) JSON reader.
+ *
+ * Like the BinaryReader, this reader latches into a failed state as soon as it encounters
+ * malformed input, rather than throwing. All subsequent reads then return default values.
+ *
+ * Objects are read by calling BeginObject(), followed by NextKey(...) until it returns false,
+ * reading each member's value in between. Arrays are read the same way, using BeginArray() and
+ * NextElement().
+ */
+class JsonReader
+{
+  public:
+    explicit JsonReader(std::istream& stream)
+        : m_stream{ stream }, m_buffer{ std::make_unique<char[]>(BufferSize) }
+    {
+    }
+
+    JsonReader(const JsonReader&) = delete;
+    JsonReader& operator=(const JsonReader&) = delete;
+
+    /**
+     * @returns True if an object was opened.
+     */
+    bool BeginObject()
+    {
+        return BeginContainer('{');
+    }
+
+    /**
+     * @brief Advances to the next member of the current object.
+     *
+     * @param[out] key            The key of the next member.
+     *
+     * @returns True if another member follows, or false if the end of the object was reached (or
+     * if the input turned out to be malformed).
+     */
+    bool NextKey(std::string& key)
+    {
+        if (!NextInContainer('}')) {
+            return false;
+        }
+
+        return ReadString(key) && Expect(':');
+    }
+
+    /**
+     * @returns True if an array was opened.
+     */
+    bool BeginArray()
+    {
+        return BeginContainer('[');
+    }
+
+    /**
+     * @brief Advances to the next element of the current array.
+     *
+     * @returns True if another element follows, or false if the end of the array was reached (or
+     * if the input turned out to be malformed).
+     */
+    bool NextElement()
+    {
+        return NextInContainer(']');
+    }
+
+    /**
+     * @brief Reads a string value, reusing the storage of the output parameter.
+     *
+     * @returns True if a string was read.
+     */
+    bool ReadString(std::string& value)
+    {
+        value.clear();
+
+        if (!Expect('"')) {
+            return false;
+        }
+
+        while (!m_hasFailed) {
+            // Copy runs of unescaped characters straight out of the buffer:
+            const auto* const start = m_buffer.get() + m_position;
+            const auto* const end = m_buffer.get() + m_bufferedSize;
+            const auto* const stop = std::find_if(start, end, [](char character) noexcept {
+                return character == '"' || character == '\\';
+            });
+
+            value.append(start, static_cast<std::size_t>(stop - start));
+            m_position += static_cast<std::size_t>(stop - start);
+
+            if (stop == end) {
+                if (!Refill()) {
+                    Fail();
+                }
+
+                continue;
+            }
+
+            if (Get() == '"') {
+                return true;
+            }
+
+            ReadEscapeSequence(value);
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Reads a string value.
+     */
+    std::string ReadString()
+    {
+        std::string value;
+        ReadString(value);
+
+        return value;
+    }
+
+    /**
+     * @brief Reads an integral value, failing if it is fractional or out of range.
+     */
+    template <typename IntegerType> IntegerType ReadInteger()
+    {
+        static_assert(std::is_integral_v<IntegerType>, "Only integers are supported.");
+
+        char token[MaximumNumberLength];
+        const auto length = ReadNumberToken(token);
+
+        IntegerType value{ 0 };
+        const auto [end, error] = std::from_chars(token, token + length, value);
+        if (error != std::errc{} || end != token + length) {
+            Fail();
+            return 0;
+        }
+
+        return value;
+    }
+
+    /**
+     * @brief Reads a numeric value. Null is read as NaN, mirroring JsonWriter::Number(...).
+     */
+    double ReadNumber()
+    {
+        if (TryReadNull()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        char token[MaximumNumberLength];
+        const auto length = ReadNumberToken(token);
+
+        double value{ 0 };
+        const auto [end, error] = std::from_chars(token, token + length, value);
+        if (error != std::errc{} || end != token + length) {
+            Fail();
+            return 0;
+        }
+
+        return value;
+    }
+
+    bool ReadBool()
+    {
+        SkipWhitespace();
+
+        if (Peek() == 't') {
+            ExpectLiteral("true");
+            return !m_hasFailed;
+        }
+
+        ExpectLiteral("false");
+        return false;
+    }
+
+    /**
+     * @returns True if the next value is null, in which case it is consumed.
+     */
+    bool TryReadNull()
+    {
+        SkipWhitespace();
+
+        if (Peek() != 'n') {
+            return false;
+        }
+
+        ExpectLiteral("null");
+        return !m_hasFailed;
+    }
+
+    /**
+     * @brief Skips over the next value, including any nested objects or arrays.
+     */
+    void SkipValue()
+    {
+        std::size_t depth{ 0 };
+        std::string scratch;
+
+        do {
+            SkipWhitespace();
+
+            switch (Peek()) {
+                case '{':
+                case '[': {
+                    Get();
+                    m_hasElements.push_back(false);
+                    ++depth;
+                    break;
+                }
+                case '}':
+                case ']': {
+                    if (depth == 0) {
+                        Fail();
+                        return;
+                    }
+
+                    Get();
+                    m_hasElements.pop_back();
+                    --depth;
+                    break;
+                }
+                case ',': {
+                    Get();
+                    break;
+                }
+                case ':': {
+                    Get();
+                    break;
+                }
+                case '"': {
+                    ReadString(scratch);
+                    break;
+                }
+                case 't':
+                case 'f': {
+                    ReadBool();
+                    break;
+                }
+                case 'n': {
+                    TryReadNull();
+                    break;
+                }
+                default: {
+                    char token[MaximumNumberLength];
+                    ReadNumberToken(token);
+                }
+            }
+        } while (depth > 0 && !m_hasFailed);
+    }
+
+    /**
+     * @returns True if nothing but whitespace remains in the input.
+     */
+    bool IsAtEnd()
+    {
+        SkipWhitespace();
+        return m_position == m_bufferedSize && !Refill();
+    }
+
+    /**
+     * @brief Puts the reader in a failed state. Codecs can use this to reject malformed data.
+     */
+    void Fail() noexcept
+    {
+        m_hasFailed = true;
+    }
+
+    /**
+     * @returns True if every read so far has succeeded.
+     */
+    bool IsGood() const noexcept
+    {
+        return !m_hasFailed;
+    }
+
+  private:
+    bool BeginContainer(char opening)
+    {
+        if (!Expect(opening)) {
+            return false;
+        }
+
+        m_hasElements.push_back(false);
+        return true;
+    }
+
+    bool NextInContainer(char closing)
+    {
+        SkipWhitespace();
+
+        if (m_hasFailed || m_hasElements.empty()) {
+            Fail();
+            return false;
+        }
+
+        if (Peek() == closing) {
+            Get();
+            m_hasElements.pop_back();
+            return false;
+        }
+
+        if (m_hasElements.back() && !Expect(',')) {
+            return false;
+        }
+
+        m_hasElements.back() = true;
+        return true;
+    }
+
+    void ReadEscapeSequence(std::string& value)
+    {
+        switch (Get()) {
+            case '"':
+                value.push_back('"');
+                break;
+            case '\\':
+                value.push_back('\\');
+                break;
+            case '/':
+                value.push_back('/');
+                break;
+            case 'b':
+                value.push_back('\b');
+                break;
+            case 'f':
+                value.push_back('\f');
+                break;
+            case 'n':
+                value.push_back('\n');
+                break;
+            case 'r':
+                value.push_back('\r');
+                break;
+            case 't':
+                value.push_back('\t');
+                break;
+            case 'u': {
+                auto codePoint = ReadHexQuad();
+
+                // Combine surrogate pairs into a single code point:
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                    if (Get() != '\\' || Get() != 'u') {
+                        Fail();
+                        return;
+                    }
+
+                    const auto lowSurrogate = ReadHexQuad();
+                    if (lowSurrogate < 0xDC00 || lowSurrogate > 0xDFFF) {
+                        Fail();
+                        return;
+                    }
+
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+                }
+
+                AppendUtf8(value, codePoint);
+                break;
+            }
+            default:
+                Fail();
+        }
+    }
+
+    std::uint32_t ReadHexQuad()
+    {
+        std::uint32_t value{ 0 };
+
+        for (int index = 0; index < 4; ++index) {
+            const auto character = Get();
+
+            std::uint32_t digit{ 0 };
+            if (character >= '0' && character <= '9') {
+                digit = static_cast<std::uint32_t>(character - '0');
+            } else if (character >= 'a' && character <= 'f') {
+                digit = static_cast<std::uint32_t>(character - 'a' + 10);
+            } else if (character >= 'A' && character <= 'F') {
+                digit = static_cast<std::uint32_t>(character - 'A' + 10);
+            } else {
+                Fail();
+                return 0;
+            }
+
+            value = (value << 4) | digit;
+        }
+
+        return value;
+    }
+
+    static void AppendUtf8(std::string& value, std::uint32_t codePoint)
+    {
+        if (codePoint < 0x80) {
+            value.push_back(static_cast<char>(codePoint));
+        } else if (codePoint < 0x800) {
+            value.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            value.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        } else if (codePoint < 0x10000) {
+            value.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            value.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            value.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        } else {
+            value.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            value.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            value.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            value.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+
+    template <std::size_t TokenSize> std::size_t ReadNumberToken(char (&token)[TokenSize])
+    {
+        SkipWhitespace();
+
+        std::size_t length{ 0 };
+        while (!m_hasFailed) {
+            const auto character = Peek();
+            if (!((character >= '0' && character <= '9') || character == '-' || character == '+' ||
+                  character == '.' || character == 'e' || character == 'E')) {
+                break;
+            }
+
+            if (length == TokenSize) {
+                Fail();
+                return 0;
+            }
+
+            token[length++] = Get();
+        }
+
+        if (length == 0) {
+            Fail();
+        }
+
+        return length;
+    }
+
+    void ExpectLiteral(std::string_view literal)
+    {
+        for (const auto character : literal) {
+            if (Get() != character) {
+                Fail();
+                return;
+            }
+        }
+    }
+
+    bool Expect(char expected)
+    {
+        SkipWhitespace();
+
+        if (Get() != expected) {
+            Fail();
+        }
+
+        return !m_hasFailed;
+    }
+
+    void SkipWhitespace()
+    {
+        while (!m_hasFailed) {
+            const auto character = Peek();
+            if (character != ' ' && character != '\n' && character != '\r' && character != '\t') {
+                return;
+            }
+
+            ++m_position;
+        }
+    }
+
+    /**
+     * @returns The next character without consuming it, or a null character at the end of the
+     * input.
+     */
+    char Peek()
+    {
+        if (m_position == m_bufferedSize && !Refill()) {
+            return '\0';
+        }
+
+        return m_buffer[m_position];
+    }
+
+    /**
+     * @returns The next character, or a null character (after failing) at the end of the input.
+     */
+    char Get()
+    {
+        if (m_position == m_bufferedSize && !Refill()) {
+            Fail();
+            return '\0';
+        }
+
+        return m_buffer[m_position++];
+    }
+
+    bool Refill()
+    {
+        if (m_hasFailed) {
+            return false;
+        }
+
+        m_stream.read(m_buffer.get(), static_cast<std::streamsize>(BufferSize));
+
+        m_position = 0;
+        m_bufferedSize = static_cast<std::size_t>(m_stream.gcount());
+
+        return m_bufferedSize > 0;
+    }
+
+    static constexpr std::size_t BufferSize{ 64 * 1024 };
+    static constexpr std::size_t MaximumNumberLength{ 32 };
+
+    std::istream& m_stream;
+
+    std::unique_ptr<char[]> m_buffer;
+    std::size_t m_bufferedSize{ 0 };
+    std::size_t m_position{ 0 };
+
+    // One entry per open object or array, recording whether any elements have been read yet:
+    std::vector<bool> m_hasElements;
+
+    bool m_hasFailed{ false };
+};
+
+/**
+ * @brief Determines how the data in each Node is represented in JSON. Custom codecs need to
+ * provide the following two functions, each of which should write or read exactly one JSON value:
+ *
+ *    void Encode(JsonWriter& writer, const DataType& data) const;
+ *    DataType Decode(JsonReader& reader) const;
+ *
+ * The default codec supports arithmetic types and `std::string`.
+ */
+template <typename DataType, typename Enable = void> struct DefaultJsonCodec;
+
+template <typename DataType>
+struct DefaultJsonCodec<DataType, std::enable_if_t<std::is_arithmetic_v<DataType>>>
+{
+    void Encode(JsonWriter& writer, DataType data) const
+    {
+        if constexpr (std::is_same_v<DataType, bool>) {
+            writer.Bool(data);
+        } else if constexpr (std::is_integral_v<DataType>) {
+            writer.Integer(data);
+        } else {
+            writer.Number(static_cast<double>(data));
+        }
+    }
+
+    DataType Decode(JsonReader& reader) const
+    {
+        if constexpr (std::is_same_v<DataType, bool>) {
+            return reader.ReadBool();
+        } else if constexpr (std::is_integral_v<DataType>) {
+            return reader.ReadInteger<DataType>();
+        } else {
+            return static_cast<DataType>(reader.ReadNumber());
+        }
+    }
+};
+
+template <> struct DefaultJsonCodec<std::string>
+{
+    void Encode(JsonWriter& writer, const std::string& data) const
+    {
+        writer.String(data);
+    }
+
+    std::string Decode(JsonReader& reader) const
+    {
+        return reader.ReadString();
+    }
+};
+
+/**
+ * @brief Writes a tree to a stream as JSON.
+ *
+ * The tree is written in a single pre-order pass, without building up any intermediate
+ * representation. Only the ancestors of the current Node need to be remembered, so memory usage
+ * is proportional to the depth of the tree, rather than to its size.
+ *
+ * @param[in] tree                The tree to write.
+ * @param[out] stream             The stream to write to.
+ * @param[in] layout              Whether to write a single nested document, or NDJSON.
+ * @param[in] codec               Writes the data stored in each Node as a JSON value.
+ *
+ * @returns True if the tree was written successfully.
+ */
+template <typename DataType, typename CodecType = DefaultJsonCodec<DataType>>
+bool WriteJson(
+    const Tree<DataType>& tree, std::ostream& stream, JsonLayout layout = JsonLayout::Nested,
+    const CodecType& codec = {})
+{
+    using NodeType = typename Tree<DataType>::Node;
+
+    JsonWriter writer{ stream };
+
+    if (layout == JsonLayout::NewlineDelimited) {
+        std::vector<std::pair<const NodeType*, std::uint64_t>> ancestors;
+        std::uint64_t nextIdentifier{ 0 };
+
+        std::for_each(tree.beginPreOrder(), tree.endPreOrder(), [&](const NodeType& node) {
+            while (!ancestors.empty() && ancestors.back().first != node.GetParent()) {
+                ancestors.pop_back();
+            }
+
+            const auto identifier = nextIdentifier++;
+
+            writer.BeginObject();
+            writer.Key("id");
+            writer.Integer(identifier);
+            writer.Key("parent");
+
+            if (ancestors.empty()) {
+                writer.Null();
+            } else {
+                writer.Integer(ancestors.back().second);
+            }
+
+            writer.Key("data");
+            codec.Encode(writer, node.GetData());
+            writer.EndObject();
+            writer.NewLine();
+
+            if (node.HasChildren()) {
+                ancestors.emplace_back(&node, identifier);
+            }
+        });
+
+        return writer.Flush();
+    }
+
+    // Only Nodes whose "children" array is still open need to be remembered:
+    std::vector<const NodeType*> openNodes;
+
+    const auto closeNode = [&] {
+        writer.EndArray();
+        writer.EndObject();
+        openNodes.pop_back();
+    };
+
+    std::for_each(tree.beginPreOrder(), tree.endPreOrder(), [&](const NodeType& node) {
+        while (!openNodes.empty() && openNodes.back() != node.GetParent()) {
+            closeNode();
+        }
+
+        writer.BeginObject();
+        writer.Key("data");
+        codec.Encode(writer, node.GetData());
+
+        if (node.HasChildren()) {
+            writer.Key("children");
+            writer.BeginArray();
+            openNodes.emplace_back(&node);
+        } else {
+            writer.EndObject();
+        }
+    });
+
+    while (!openNodes.empty()) {
+        closeNode();
+    }
+
+    writer.NewLine();
+
+    return writer.Flush();
+}
+
+namespace Detail
+{
+template <typename DataType, typename CodecType>
+std::optional<Tree<DataType>> ReadNestedJson(JsonReader& reader, const CodecType& codec)
+{
+    using NodeType = typename Tree<DataType>::Node;
+
+    std::string key;
+
+    // Reads up to, and including, the data of the next Node. The data has to precede the children,
+    // since a Node cannot be created without it:
+    const auto readNodeData = [&]() -> std::optional<DataType> {
+        if (!reader.BeginObject()) {
+            return std::nullopt;
+        }
+
+        while (reader.NextKey(key)) {
+            if (key == "data") {
+                return codec.Decode(reader);
+            }
+
+            reader.SkipValue();
+        }
+
+        reader.Fail();
+        return std::nullopt;
+    };
+
+    // Reads the remaining members of a Node, up to and including the start of its children:
+    const auto beginChildren = [&] {
+        while (reader.NextKey(key)) {
+            if (key == "children") {
+                return reader.BeginArray();
+            }
+
+            reader.SkipValue();
+        }
+
+        return false;
+    };
+
+    const auto skipRemainingMembers = [&] {
+        while (reader.NextKey(key)) {
+            reader.SkipValue();
+        }
+    };
+
+    auto rootData = readNodeData();
+    if (!rootData || !reader.IsGood()) {
+        return std::nullopt;
+    }
+
+    Tree<DataType> tree{ std::move(*rootData) };
+
+    // Holds every Node whose "children" array is still being read:
+    std::vector<NodeType*> openNodes;
+    if (beginChildren()) {
+        openNodes.emplace_back(tree.GetRoot());
+    }
+
+    while (!openNodes.empty() && reader.IsGood()) {
+        if (!reader.NextElement()) {
+            skipRemainingMembers();
+            openNodes.pop_back();
+            continue;
+        }
+
+        auto childData = readNodeData();
+        if (!childData) {
+            break;
+        }
+
+        auto* const child = openNodes.back()->AppendChild(std::move(*childData));
+        if (beginChildren()) {
+            openNodes.emplace_back(child);
+        }
+    }
+
+    if (!reader.IsGood() || !reader.IsAtEnd()) {
+        return std::nullopt;
+    }
+
+    return tree;
+}
+
+template <typename DataType, typename CodecType>
+std::optional<Tree<DataType>> ReadNewlineDelimitedJson(JsonReader& reader, const CodecType& codec)
+{
+    using NodeType = typename Tree<DataType>::Node;
+
+    std::optional<Tree<DataType>> tree;
+
+    // Since records are listed in pre-order, the parent of every record has to be one of the
+    // ancestors of the previous record:
+    std::vector<std::pair<std::uint64_t, NodeType*>> ancestors;
+    std::string key;
+
+    while (!reader.IsAtEnd() && reader.IsGood()) {
+        std::optional<std::uint64_t> identifier;
+        std::optional<std::uint64_t> parent;
+        std::optional<DataType> data;
+
+        reader.BeginObject();
+        while (reader.NextKey(key)) {
+            if (key == "id") {
+                identifier = reader.ReadInteger<std::uint64_t>();
+            } else if (key == "parent") {
+                if (!reader.TryReadNull()) {
+                    parent = reader.ReadInteger<std::uint64_t>();
+                }
+            } else if (key == "data") {
+                data = codec.Decode(reader);
+            } else {
+                reader.SkipValue();
+            }
+        }
+
+        if (!reader.IsGood() || !identifier || !data || parent.has_value() != tree.has_value()) {
+            return std::nullopt;
+        }
+
+        NodeType* node = nullptr;
+
+        if (!tree) {
+            tree.emplace(std::move(*data));
+            node = tree->GetRoot();
+        } else {
+            while (!ancestors.empty() && ancestors.back().first != *parent) {
+                ancestors.pop_back();
+            }
+
+            if (ancestors.empty()) {
+                return std::nullopt;
+            }
+
+            node = ancestors.back().second->AppendChild(std::move(*data));
+        }
+
+        ancestors.emplace_back(*identifier, node);
+    }
+
+    if (!reader.IsGood()) {
+        return std::nullopt;
+    }
+
+    return tree;
+}
+} // namespace Detail
+
+/**
+ * @brief Reads a tree that was written as JSON.
+ *
+ * Input is parsed in a single streaming pass, and Nodes are appended to the tree as soon as they
+ * are encountered, so no intermediate document is ever built. In the nested layout, the "data"
+ * member of each Node needs to precede its "children". In the newline-delimited layout, records
+ * need to be listed in pre-order, as they are by WriteJson(...). In both layouts, any unknown
+ * members are skipped.
+ *
+ * @param[in] stream              The stream to read from.
+ * @param[in] layout              Whether to read a single nested document, or NDJSON.
+ * @param[in] codec               Reads the data stored in each Node. This needs to mirror the
+ *                                codec that was used to write the tree.
+ *
+ * @returns The loaded tree, or std::nullopt if the input was malformed or truncated.
+ */
+template <typename DataType, typename CodecType = DefaultJsonCodec<DataType>>
+std::optional<Tree<DataType>> ReadJson(
+    std::istream& stream, JsonLayout layout = JsonLayout::Nested, const CodecType& codec = {})
+{
+    JsonReader reader{ stream };
+
+    if (layout == JsonLayout::NewlineDelimited) {
+        return Detail::ReadNewlineDelimitedJson<DataType>(reader, codec);
+    }
+
+    return Detail::ReadNestedJson<DataType>(reader, codec);
+}
+} // namespace TreeUtilities
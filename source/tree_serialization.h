@@ -0,0 +1,457 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tree.h"
+
+namespace TreeUtilities
+{
+/**
+ * @brief A buffered writer for the little-endian binary encoding used to persist trees.
+ */
+class BinaryWriter
+{
+  public:
+    explicit BinaryWriter(std::ostream& stream)
+        : m_stream{ stream }, m_buffer{ std::make_unique<char[]>(BufferSize) }
+    {
+    }
+
+    BinaryWriter(const BinaryWriter&) = delete;
+    BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+    /**
+     * @brief Flushes any remaining buffered output to the underlying stream.
+     */
+    ~BinaryWriter()
+    {
+        Flush();
+    }
+
+    /**
+     * @brief Writes the raw bytes of the specified buffer.
+     */
+    void WriteBytes(const void* data, std::size_t size)
+    {
+        if (m_bufferedSize + size > BufferSize) {
+            Flush();
+
+            if (size > BufferSize) {
+                m_stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+                return;
+            }
+        }
+
+        std::memcpy(m_buffer.get() + m_bufferedSize, data, size);
+        m_bufferedSize += size;
+    }
+
+    /**
+     * @brief Writes an unsigned integer in little-endian order, using exactly as many bytes as the
+     * integer type occupies.
+     */
+    template <typename IntegerType> void WriteFixed(IntegerType value)
+    {
+        static_assert(std::is_unsigned_v<IntegerType>, "Only unsigned integers are supported.");
+
+        unsigned char bytes[sizeof(IntegerType)];
+        for (auto& byte : bytes) {
+            byte = static_cast<unsigned char>(value & 0xFF);
+            value = static_cast<IntegerType>(value >> 8);
+        }
+
+        WriteBytes(bytes, sizeof(bytes));
+    }
+
+    /**
+     * @brief Writes an unsigned integer using a variable-length (LEB128) encoding, so that small
+     * values take up only a single byte.
+     */
+    void WriteVarint(std::uint64_t value)
+    {
+        unsigned char bytes[10];
+        std::size_t size = 0;
+
+        while (value >= 0x80) {
+            bytes[size++] = static_cast<unsigned char>(value | 0x80);
+            value >>= 7;
+        }
+
+        bytes[size++] = static_cast<unsigned char>(value);
+
+        WriteBytes(bytes, size);
+    }
+
+    /**
+     * @brief Writes a length-prefixed string.
+     */
+    void WriteString(std::string_view value)
+    {
+        WriteVarint(value.size());
+        WriteBytes(value.data(), value.size());
+    }
+
+    /**
+     * @brief Hands all buffered output to the underlying stream.
+     *
+     * @returns True if the underlying stream is still in a good state.
+     */
+    bool Flush()
+    {
+        if (m_bufferedSize > 0) {
+            m_stream.write(m_buffer.get(), static_cast<std::streamsize>(m_bufferedSize));
+            m_bufferedSize = 0;
+        }
+
+        return m_stream.good();
+    }
+
+  private:
+    static constexpr std::size_t BufferSize{ 64 * 1024 };
+
+    std::ostream& m_stream;
+
+    std::unique_ptr<char[]> m_buffer;
+    std::size_t m_bufferedSize{ 0 };
+};
+
+/**
+ * @brief A buffered reader for the binary encoding produced by the BinaryWriter.
+ *
+ * Rather than throwing, the reader latches into a failed state as soon as it encounters
+ * truncated or malformed input. All subsequent reads will then return zero-initialized values.
+ */
+class BinaryReader
+{
+  public:
+    explicit BinaryReader(std::istream& stream)
+        : m_stream{ stream }, m_buffer{ std::make_unique<char[]>(BufferSize) }
+    {
+    }
+
+    BinaryReader(const BinaryReader&) = delete;
+    BinaryReader& operator=(const BinaryReader&) = delete;
+
+    /**
+     * @brief Reads exactly |size| bytes into the specified buffer.
+     *
+     * @returns True if all bytes could be read.
+     */
+    bool ReadBytes(void* data, std::size_t size)
+    {
+        auto* output = static_cast<char*>(data);
+
+        while (size > 0 && !m_hasFailed) {
+            if (m_position == m_bufferedSize && !Refill()) {
+                Fail();
+                break;
+            }
+
+            const auto chunkSize = std::min(size, m_bufferedSize - m_position);
+            std::memcpy(output, m_buffer.get() + m_position, chunkSize);
+
+            m_position += chunkSize;
+            output += chunkSize;
+            size -= chunkSize;
+        }
+
+        return !m_hasFailed;
+    }
+
+    /**
+     * @brief Reads an unsigned integer that was written by BinaryWriter::WriteFixed(...).
+     */
+    template <typename IntegerType> IntegerType ReadFixed()
+    {
+        static_assert(std::is_unsigned_v<IntegerType>, "Only unsigned integers are supported.");
+
+        unsigned char bytes[sizeof(IntegerType)] = {};
+        ReadBytes(bytes, sizeof(bytes));
+
+        IntegerType value{ 0 };
+        for (std::size_t index = sizeof(IntegerType); index > 0; --index) {
+            value = static_cast<IntegerType>((value << 8) | bytes[index - 1]);
+        }
+
+        return value;
+    }
+
+    /**
+     * @brief Reads an unsigned integer that was written by BinaryWriter::WriteVarint(...).
+     */
+    std::uint64_t ReadVarint()
+    {
+        std::uint64_t value{ 0 };
+
+        for (unsigned int shift = 0; shift < 64; shift += 7) {
+            unsigned char byte{ 0 };
+            if (!ReadBytes(&byte, 1)) {
+                return 0;
+            }
+
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+
+        Fail();
+        return 0;
+    }
+
+    /**
+     * @brief Reads a string that was written by BinaryWriter::WriteString(...).
+     */
+    std::string ReadString()
+    {
+        const auto size = ReadVarint();
+        if (size > MaximumStringSize) {
+            Fail();
+            return {};
+        }
+
+        std::string value(static_cast<std::size_t>(size), '\0');
+        if (!ReadBytes(value.data(), value.size())) {
+            return {};
+        }
+
+        return value;
+    }
+
+    /**
+     * @brief Puts the reader in a failed state. Codecs can use this to reject malformed data.
+     */
+    void Fail() noexcept
+    {
+        m_hasFailed = true;
+    }
+
+    /**
+     * @returns True if every read so far has succeeded.
+     */
+    bool IsGood() const noexcept
+    {
+        return !m_hasFailed;
+    }
+
+  private:
+    bool Refill()
+    {
+        m_stream.read(m_buffer.get(), static_cast<std::streamsize>(BufferSize));
+
+        m_position = 0;
+        m_bufferedSize = static_cast<std::size_t>(m_stream.gcount());
+
+        return m_bufferedSize > 0;
+    }
+
+    static constexpr std::size_t BufferSize{ 64 * 1024 };
+
+    // Guards against allocating absurd amounts of memory when reading corrupt input:
+    static constexpr std::uint64_t MaximumStringSize{ 1ull << 32 };
+
+    std::istream& m_stream;
+
+    std::unique_ptr<char[]> m_buffer;
+    std::size_t m_bufferedSize{ 0 };
+    std::size_t m_position{ 0 };
+
+    bool m_hasFailed{ false };
+};
+
+/**
+ * @brief Determines how the data in each Node is encoded. Custom codecs need to provide the
+ * following two functions:
+ *
+ *    void Encode(BinaryWriter& writer, const DataType& data) const;
+ *    DataType Decode(BinaryReader& reader) const;
+ *
+ * A codec may also declare a `static constexpr std::uint32_t Version` member. This version is
+ * stored alongside the tree, and data written by any other version of the codec is rejected,
+ * rather than decoded as if the payload had the current layout. Codecs that don't declare one
+ * are assumed to be at version zero.
+ *
+ * The default codec supports arithmetic types and `std::string`. Other types, even trivially
+ * copyable ones, need a codec of their own, since their in-memory representation may contain
+ * padding, pointers, or platform-specific layouts that don't belong in a file.
+ */
+template <typename DataType, typename Enable = void> struct DefaultCodec
+{
+    static_assert(
+        sizeof(DataType) == 0,
+        "There's no default codec for this type; pass a custom codec to Save(...) and Load(...).");
+};
+
+/**
+ * @brief Stores integers and floating-point numbers as unsigned integers of the same width, in
+ * little-endian order, so that files can be exchanged between platforms.
+ */
+template <typename DataType>
+struct DefaultCodec<DataType, std::enable_if_t<std::is_arithmetic_v<DataType>>>
+{
+    static_assert(
+        sizeof(DataType) == 1 || sizeof(DataType) == 2 || sizeof(DataType) == 4 ||
+            sizeof(DataType) == 8,
+        "Only 8, 16, 32, and 64-bit arithmetic types are supported.");
+
+    using EncodedType = std::conditional_t<
+        sizeof(DataType) == 1, std::uint8_t,
+        std::conditional_t<
+            sizeof(DataType) == 2, std::uint16_t,
+            std::conditional_t<sizeof(DataType) == 4, std::uint32_t, std::uint64_t>>>;
+
+    void Encode(BinaryWriter& writer, const DataType& data) const
+    {
+        EncodedType value;
+        std::memcpy(&value, &data, sizeof(value));
+
+        writer.WriteFixed(value);
+    }
+
+    DataType Decode(BinaryReader& reader) const
+    {
+        const auto value = reader.ReadFixed<EncodedType>();
+
+        if constexpr (std::is_same_v<DataType, bool>) {
+            return value != 0;
+        } else {
+            DataType data;
+            std::memcpy(&data, &value, sizeof(data));
+
+            return data;
+        }
+    }
+};
+
+template <> struct DefaultCodec<std::string>
+{
+    void Encode(BinaryWriter& writer, const std::string& data) const
+    {
+        writer.WriteString(data);
+    }
+
+    std::string Decode(BinaryReader& reader) const
+    {
+        return reader.ReadString();
+    }
+};
+
+namespace Detail
+{
+constexpr char SerializationMagic[4] = { 'T', 'R', 'E', 'E' };
+constexpr std::uint32_t SerializationVersion{ 1 };
+
+template <typename CodecType, typename = void>
+struct CodecVersion : std::integral_constant<std::uint32_t, 0>
+{
+};
+
+template <typename CodecType>
+struct CodecVersion<CodecType, std::void_t<decltype(CodecType::Version)>>
+    : std::integral_constant<std::uint32_t, CodecType::Version>
+{
+};
+} // namespace Detail
+
+/**
+ * @brief Writes a tree to a binary stream.
+ *
+ * The format consists of a small header, holding the version of both the format and the codec,
+ * followed by every Node in pre-order. Each Node is stored as a variable-length child count,
+ * followed by its data as encoded by the codec. This makes the format self-delimiting, and allows
+ * it to be produced and consumed in a single streaming pass.
+ *
+ * @param[in] tree                The tree to save.
+ * @param[out] stream             The stream to write to. This should be opened in binary mode.
+ * @param[in] codec               Encodes the data stored in each Node.
+ *
+ * @returns True if the tree was written successfully.
+ */
+template <typename DataType, typename CodecType = DefaultCodec<DataType>>
+bool Save(const Tree<DataType>& tree, std::ostream& stream, const CodecType& codec = {})
+{
+    BinaryWriter writer{ stream };
+
+    writer.WriteBytes(Detail::SerializationMagic, sizeof(Detail::SerializationMagic));
+    writer.WriteFixed(Detail::SerializationVersion);
+    writer.WriteFixed(Detail::CodecVersion<CodecType>::value);
+
+    std::for_each(tree.beginPreOrder(), tree.endPreOrder(), [&](const auto& node) {
+        writer.WriteVarint(node.GetChildCount());
+        codec.Encode(writer, node.GetData());
+    });
+
+    return writer.Flush();
+}
+
+/**
+ * @brief Reads a tree that was previously written by Save(...).
+ *
+ * @param[in] stream              The stream to read from. This should be opened in binary mode.
+ * @param[in] codec               Decodes the data stored in each Node. This needs to mirror the
+ *                                codec that was used to save the tree.
+ *
+ * @returns The loaded tree, or std::nullopt if the input was malformed, truncated, or written
+ * using an unsupported version of the format or of the codec.
+ */
+template <typename DataType, typename CodecType = DefaultCodec<DataType>>
+std::optional<Tree<DataType>> Load(std::istream& stream, const CodecType& codec = {})
+{
+    using NodeType = typename Tree<DataType>::Node;
+
+    BinaryReader reader{ stream };
+
+    char magic[sizeof(Detail::SerializationMagic)] = {};
+    reader.ReadBytes(magic, sizeof(magic));
+
+    const auto version = reader.ReadFixed<std::uint32_t>();
+    const auto codecVersion = reader.ReadFixed<std::uint32_t>();
+    if (!reader.IsGood() || std::memcmp(magic, Detail::SerializationMagic, sizeof(magic)) != 0 ||
+        version != Detail::SerializationVersion ||
+        codecVersion != Detail::CodecVersion<CodecType>::value) {
+        return std::nullopt;
+    }
+
+    const auto rootChildCount = reader.ReadVarint();
+    Tree<DataType> tree{ codec.Decode(reader) };
+
+    // Each entry tracks a Node whose children are still being read, and how many remain:
+    std::vector<std::pair<NodeType*, std::uint64_t>> stack;
+    if (rootChildCount > 0) {
+        stack.emplace_back(tree.GetRoot(), rootChildCount);
+    }
+
+    while (!stack.empty() && reader.IsGood()) {
+        auto& [parent, remainingChildren] = stack.back();
+
+        auto* const parentNode = parent;
+        if (--remainingChildren == 0) {
+            stack.pop_back();
+        }
+
+        const auto childCount = reader.ReadVarint();
+        auto* const child = parentNode->AppendChild(codec.Decode(reader));
+
+        if (childCount > 0) {
+            stack.emplace_back(child, childCount);
+        }
+    }
+
+    if (!reader.IsGood()) {
+        return std::nullopt;
+    }
+
+    return tree;
+}
+} // namespace TreeUtilities
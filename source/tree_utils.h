@@ -1,12 +1,23 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <codecvt>
+#include <cstdint>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <locale>
-#include <sstream>
+#include <memory>
+#include <optional>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "tree.h"
 
@@ -17,7 +28,7 @@ namespace
  *
  * @note Depending on what code page is active, this may not do what you expect.
  */
-std::ostream& operator<<(std::ostream& stream, std::wstring wideString)
+inline std::ostream& operator<<(std::ostream& stream, std::wstring wideString)
 {
     using WideToNarrowConverterType = std::codecvt_utf8<wchar_t>;
     thread_local static std::wstring_convert<WideToNarrowConverterType, wchar_t> converter;
@@ -29,50 +40,553 @@ std::ostream& operator<<(std::ostream& stream, std::wstring wideString)
 
 namespace TreeUtilities
 {
-template <typename NodeType>
-void OutputToDotFile(const Tree<NodeType>& tree, const std::string& fileName)
+/**
+ * @brief Limits on how much of a tree is written by OutputToDot(...).
+ *
+ * Nodes that fall outside of these limits aren't written individually. Instead, they're
+ * aggregated into a single summary Node, which is attached to the nearest visible ancestor.
+ */
+template <typename DataType> struct DotOptions
 {
-    std::stringstream graphStream;
+    // The deepest level at which Nodes are still written, where the root is at depth zero:
+    std::size_t maximumDepth{ std::numeric_limits<std::size_t>::max() };
+
+    // The maximum number of children written per Node. Any remaining children are collapsed:
+    std::size_t maximumChildren{ std::numeric_limits<std::size_t>::max() };
+
+    // If set, any subtree for which this returns true is collapsed, regardless of the limits:
+    std::function<bool(const typename Tree<DataType>::Node&)> shouldCollapse;
+};
 
-    graphStream << "digraph {\n"
-                << "   rankdir = TB;\n"
-                << "   edge [arrowsize=0.4, fontsize=10]\n";
+/**
+ * @brief The default summary for collapsed Nodes, which simply counts them.
+ *
+ * Custom summaries need to be copyable, and provide the following two functions:
+ *
+ *    void Add(const Tree<DataType>::Node& node);
+ *    void Write(std::ostream& stream) const;
+ *
+ * Add(...) is invoked once for every collapsed Node, including all of their descendants, while
+ * Write(...) should output the label of the summary Node.
+ */
+template <typename DataType> class DotNodeCountSummary
+{
+  public:
+    void Add(const typename Tree<DataType>::Node&) noexcept
+    {
+        ++m_nodeCount;
+    }
 
-    const Node<NodeType>* head = tree.GetRoot();
+    void Write(std::ostream& stream) const
+    {
+        stream << m_nodeCount << (m_nodeCount == 1 ? " more node" : " more nodes");
+    }
 
-    graphStream << "\n"
-                << "   // Node Declarations:\n";
+  private:
+    std::size_t m_nodeCount{ 0 };
+};
 
-    std::for_each(
-        Tree<NodeType>::PreOrderIterator{ head }, Tree<NodeType>::PreOrderIterator{},
-        [&](Tree<NodeType>::const_reference node) {
-            const auto nodeLabel = std::to_string(reinterpret_cast<size_t>(&node));
-            const auto& data = node.GetData();
+/**
+ * @brief Writes the tree to a stream in the DOT format, for use with Graphviz.
+ *
+ * The tree is written in a single pre-order pass, in which every Node is declared along with the
+ * edge to its parent. Nodes are identified by sequential numbers, so that only the identifiers of
+ * the current Node's ancestors need to be remembered.
+ *
+ * When limits are specified, the traversal still visits every Node, so that the summaries of
+ * collapsed Nodes can be aggregated in that same pass. Each summary is written as soon as the
+ * subtree of the visible Node that it belongs to has been fully traversed.
+ *
+ * @param[in] tree                The tree to write.
+ * @param[out] stream             The stream to write to.
+ * @param[in] options             Determines which Nodes are written, and which are collapsed.
+ * @param[in] summary             The initial state of the summary of any collapsed Nodes.
+ */
+template <typename DataType, typename SummaryType = DotNodeCountSummary<DataType>>
+void OutputToDot(
+    const Tree<DataType>& tree, std::ostream& stream, const DotOptions<DataType>& options = {},
+    const SummaryType& summary = {})
+{
+    using NodeType = typename Tree<DataType>::Node;
 
-            graphStream << "   " << nodeLabel << " [label = \"" << data << "\"]\n";
-        });
+    struct Frame
+    {
+        const NodeType* node;
+        std::size_t identifier;
+        std::size_t depth;
+
+        // The index of the Frame of the visible Node that this Node is written as, or collapsed
+        // into:
+        std::size_t owner;
+
+        std::size_t visibleChildCount;
+        std::size_t collapsedNodeCount;
+    };
+
+    stream << "digraph {\n"
+           << "   rankdir = TB;\n"
+           << "   edge [arrowsize=0.4, fontsize=10]\n"
+           << "\n";
+
+    char digits[std::numeric_limits<std::size_t>::digits10 + 1];
+    const auto writeIdentifier = [&](std::size_t identifier) {
+        const auto [end, error] = std::to_chars(std::begin(digits), std::end(digits), identifier);
+        stream.write(digits, end - digits);
+    };
+
+    const auto writeEdge = [&](std::size_t from, std::size_t to) {
+        stream << "   ";
+        writeIdentifier(from);
+        stream << " -> ";
+        writeIdentifier(to);
+        stream << '\n';
+    };
+
+    std::vector<Frame> ancestors;
+    std::size_t nextIdentifier{ 0 };
+
+    // Since the descendants of a collapsed Node are collapsed as well, the visible Nodes always
+    // occupy the first Frames. Their summaries are therefore kept apart, indexed by the position
+    // of the owning Frame, and only created once something actually collapses into that Frame:
+    std::vector<std::optional<SummaryType>> summaries;
+
+    const auto popFrame = [&] {
+        const auto& frame = ancestors.back();
+        const auto index = ancestors.size() - 1;
+
+        if (frame.collapsedNodeCount > 0 && frame.owner == index) {
+            const auto identifier = nextIdentifier++;
+
+            stream << "   ";
+            writeIdentifier(identifier);
+            stream << " [label = \"";
+            summaries[index]->Write(stream);
+            stream << "\", shape = box, style = dashed]\n";
+
+            writeEdge(frame.identifier, identifier);
+            summaries[index].reset();
+        }
+
+        ancestors.pop_back();
+    };
+
+    std::for_each(tree.beginPreOrder(), tree.endPreOrder(), [&](const NodeType& node) {
+        while (!ancestors.empty() && ancestors.back().node != node.GetParent()) {
+            popFrame();
+        }
+
+        if (!ancestors.empty()) {
+            auto& parent = ancestors.back();
+            auto& owner = ancestors[parent.owner];
+
+            const bool isCollapsed = parent.owner != ancestors.size() - 1 ||
+                                     parent.depth >= options.maximumDepth ||
+                                     parent.visibleChildCount >= options.maximumChildren ||
+                                     (options.shouldCollapse && options.shouldCollapse(node));
+
+            if (isCollapsed) {
+                if (summaries.size() <= parent.owner) {
+                    summaries.resize(parent.owner + 1);
+                }
+
+                auto& ownerSummary = summaries[parent.owner];
+                if (!ownerSummary) {
+                    ownerSummary.emplace(summary);
+                }
+
+                ++owner.collapsedNodeCount;
+                ownerSummary->Add(node);
 
-    graphStream << "\n"
-                << "   // Edge Declarations:\n";
+                // Collapsed Nodes only need a Frame if their descendants have to be aggregated:
+                if (node.HasChildren()) {
+                    ancestors.push_back(Frame{ &node, 0, parent.depth + 1, parent.owner, 0, 0 });
+                }
 
-    std::for_each(
-        Tree<NodeType>::PreOrderIterator{ head }, Tree<NodeType>::PreOrderIterator{},
-        [&](Tree<NodeType>::const_reference node) {
-            const auto* parent = node.GetParent();
-            if (!parent) {
                 return;
             }
 
-            const auto parentLabel = std::to_string(reinterpret_cast<std::size_t>(parent));
-            const auto childLabel = std::to_string(reinterpret_cast<std::size_t>(&node));
+            ++parent.visibleChildCount;
+        }
 
-            graphStream << "   " << parentLabel << " -> " << childLabel << "\n";
+        const auto identifier = nextIdentifier++;
+
+        stream << "   ";
+        writeIdentifier(identifier);
+        stream << " [label = \"" << node.GetData() << "\"]\n";
+
+        if (!ancestors.empty()) {
+            writeEdge(ancestors.back().identifier, identifier);
+        }
+
+        const auto depth = ancestors.empty() ? 0 : ancestors.back().depth + 1;
+        ancestors.push_back(Frame{ &node, identifier, depth, ancestors.size(), 0, 0 });
+    });
+
+    while (!ancestors.empty()) {
+        popFrame();
+    }
+
+    stream << "}\n" << std::flush;
+}
+
+/**
+ * @brief Writes the tree to a DOT file, for use with Graphviz.
+ *
+ * @see OutputToDot(...)
+ *
+ * @param[in] tree                The tree to write.
+ * @param[in] fileName            The path of the file to create.
+ * @param[in] options             Determines which Nodes are written, and which are collapsed.
+ * @param[in] summary             The initial state of the summary of any collapsed Nodes.
+ */
+template <typename DataType, typename SummaryType = DotNodeCountSummary<DataType>>
+void OutputToDotFile(
+    const Tree<DataType>& tree, const std::string& fileName,
+    const DotOptions<DataType>& options = {}, const SummaryType& summary = {})
+{
+    constexpr std::size_t bufferSize{ 64 * 1024 };
+    const auto buffer = std::make_unique<char[]>(bufferSize);
+
+    // The buffer has to be installed before the file is opened in order to take effect:
+    std::ofstream outputFile;
+    outputFile.rdbuf()->pubsetbuf(buffer.get(), bufferSize);
+    outputFile.open(fileName, std::ofstream::out);
+
+    OutputToDot(tree, outputFile, options, summary);
+}
+
+/**
+ * @brief The kinds of differences that Diff(...) can report.
+ */
+enum class EditKind
+{
+    Added,
+    Removed,
+    Modified,
+    Moved
+};
+
+/**
+ * @brief A single difference between two trees.
+ *
+ * Added and removed subtrees are only reported once, at the root of the subtree, so the old or new
+ * Node of such an Edit implies everything underneath it as well.
+ */
+template <typename DataType> struct Edit
+{
+    EditKind kind;
+
+    // The Node in the old tree, or nullptr if the Node was added:
+    const typename Tree<DataType>::Node* oldNode;
+
+    // The Node in the new tree, or nullptr if the Node was removed:
+    const typename Tree<DataType>::Node* newNode;
+};
+
+namespace Detail
+{
+/**
+ * @returns True if both subtrees carry current hashes that are equal.
+ */
+template <typename DataType>
+bool HaveEqualSubtreeHashes(
+    const typename Tree<DataType>::Node& lhs, const typename Tree<DataType>::Node& rhs) noexcept
+{
+    if constexpr (TreeTraits<DataType>::EnableSubtreeHashes) {
+        return !lhs.IsSubtreeHashStale() && !rhs.IsSubtreeHashStale() &&
+               lhs.GetSubtreeHash() == rhs.GetSubtreeHash();
+    } else {
+        return false;
+    }
+}
+
+/**
+ * @brief Compares the subtrees rooted at a pair of Nodes that are already known to correspond.
+ *
+ * Children are matched by key, and subtrees with equal, current hashes are skipped outright.
+ *
+ * @param[in] oldNode             The root of the subtree in the old tree.
+ * @param[in] newNode             The root of the subtree in the new tree.
+ * @param[in] keyFunction         Extracts the key by which siblings are matched.
+ * @param[in] equalFunction       Determines whether the data of a pair of matched Nodes is equal.
+ * @param[in] descendIntoChildren Whether matched children should be compared as well, or merely
+ *                                be handed to |onMatchedChildren|.
+ * @param[out] edits              The edit stream to append to.
+ * @param[out] onMatchedChildren  Invoked with each pair of matched children that still needs to be
+ *                                compared if |descendIntoChildren| is false.
+ */
+template <
+    typename DataType, typename KeyFunctionType, typename EqualFunctionType,
+    typename MatchedChildrenCallbackType>
+void DiffSubtrees(
+    const typename Tree<DataType>::Node& oldNode, const typename Tree<DataType>::Node& newNode,
+    const KeyFunctionType& keyFunction, const EqualFunctionType& equalFunction,
+    bool descendIntoChildren, std::vector<Edit<DataType>>& edits,
+    const MatchedChildrenCallbackType& onMatchedChildren)
+{
+    using NodeType = typename Tree<DataType>::Node;
+    using KeyType = std::decay_t<std::invoke_result_t<const KeyFunctionType&, const DataType&>>;
+
+    struct Candidate
+    {
+        const NodeType* node;
+        bool isMatched;
+    };
+
+    // An explicit stack avoids running out of stack space on very deep trees:
+    std::vector<std::pair<const NodeType*, const NodeType*>> pendingPairs{ { &oldNode, &newNode } };
+    std::unordered_map<KeyType, Candidate> oldChildren;
+
+    while (!pendingPairs.empty()) {
+        const auto [oldParent, newParent] = pendingPairs.back();
+        pendingPairs.pop_back();
+
+        if (HaveEqualSubtreeHashes<DataType>(*oldParent, *newParent)) {
+            continue;
+        }
+
+        if (!equalFunction(oldParent->GetData(), newParent->GetData())) {
+            edits.push_back({ EditKind::Modified, oldParent, newParent });
+        }
+
+        oldChildren.clear();
+        oldChildren.reserve(oldParent->GetChildCount());
+
+        for (auto* child = oldParent->GetFirstChild(); child; child = child->GetNextSibling()) {
+            oldChildren.emplace(keyFunction(child->GetData()), Candidate{ child, false });
+        }
+
+        const auto firstPendingChild = pendingPairs.size();
+
+        for (auto* child = newParent->GetFirstChild(); child; child = child->GetNextSibling()) {
+            const auto match = oldChildren.find(keyFunction(child->GetData()));
+            if (match == std::end(oldChildren) || match->second.isMatched) {
+                edits.push_back({ EditKind::Added, nullptr, child });
+                continue;
+            }
+
+            match->second.isMatched = true;
+
+            if (descendIntoChildren) {
+                pendingPairs.emplace_back(match->second.node, child);
+            } else {
+                onMatchedChildren(*match->second.node, *child);
+            }
+        }
+
+        // Reverse the newly queued pairs so that they're popped in sibling order:
+        std::reverse(pendingPairs.begin() + firstPendingChild, pendingPairs.end());
+
+        for (auto* child = oldParent->GetFirstChild(); child; child = child->GetNextSibling()) {
+            // Only the first of several siblings with the same key can ever be matched:
+            const auto match = oldChildren.find(keyFunction(child->GetData()));
+            if (match->second.node != child || !match->second.isMatched) {
+                edits.push_back({ EditKind::Removed, child, nullptr });
+            }
+        }
+    }
+}
+
+/**
+ * @brief Collapses each removed subtree that reappears, with an identical subtree hash, as an
+ * added subtree elsewhere into a single move.
+ */
+template <typename DataType> void DetectMoves(std::vector<Edit<DataType>>& edits)
+{
+    // Moves can only be recognized by their subtree hashes:
+    if constexpr (TreeTraits<DataType>::EnableSubtreeHashes) {
+        std::unordered_multimap<std::uint64_t, std::size_t> removals;
+
+        for (std::size_t index = 0; index < edits.size(); ++index) {
+            const auto& edit = edits[index];
+            if (edit.kind == EditKind::Removed && !edit.oldNode->IsSubtreeHashStale()) {
+                removals.emplace(edit.oldNode->GetSubtreeHash(), index);
+            }
+        }
+
+        if (removals.empty()) {
+            return;
+        }
+
+        for (auto& edit : edits) {
+            if (edit.kind != EditKind::Added || edit.newNode->IsSubtreeHashStale()) {
+                continue;
+            }
+
+            const auto match = removals.find(edit.newNode->GetSubtreeHash());
+            if (match == std::end(removals)) {
+                continue;
+            }
+
+            auto& removal = edits[match->second];
+            removal.kind = EditKind::Moved;
+            removal.newNode = edit.newNode;
+
+            edit.newNode = nullptr;
+            removals.erase(match);
+        }
+
+        edits.erase(
+            std::remove_if(
+                std::begin(edits), std::end(edits),
+                [](const auto& edit) noexcept {
+                    return edit.kind == EditKind::Added && edit.newNode == nullptr;
+                }),
+            std::end(edits));
+    }
+}
+} // namespace Detail
+
+/**
+ * @brief Computes the differences between two snapshots of what is assumed to be the same tree.
+ *
+ * The roots of both trees are always considered to correspond, while all other Nodes are matched
+ * to one of their siblings by key. Matched Nodes whose data differs are reported as modified, and
+ * unmatched Nodes are reported as added or removed. If subtree hashes are enabled through
+ * TreeTraits<DataType>, and both trees carry current ones (see Tree::UpdateSubtreeHashes(...)),
+ * subtrees with identical hashes are skipped in constant
+ * time, and added subtrees that are identical to a removed subtree are reported as moves.
+ *
+ * @param[in] oldTree             The earlier snapshot.
+ * @param[in] newTree             The later snapshot.
+ * @param[in] keyFunction         A callable that returns the key by which siblings are matched,
+ *                                and that can safely be invoked from multiple threads at once.
+ *                                Returning a lightweight type, like a `std::string_view`, avoids
+ *                                copying keys. This type should be equivalent to:
+ *                                   KeyType keyFunction(const DataType& data);
+ * @param[in] equalFunction       A callable that determines whether matched Nodes are unchanged,
+ *                                and that can safely be invoked from multiple threads at once.
+ *                                This type should be equivalent to:
+ *                                   bool equalFunction(const DataType& lhs, const DataType& rhs);
+ * @param[in] threadCount         The maximum number of threads across which the top-level subtrees
+ *                                are compared. Both callables are shared by all of these threads,
+ *                                so pass one to keep every invocation on the calling thread.
+ *
+ * @returns The edit stream. The edits concerning the roots and their direct children come first,
+ * followed by those within each matched top-level subtree, in the sibling order of the new tree.
+ */
+template <typename DataType, typename KeyFunctionType, typename EqualFunctionType>
+std::vector<Edit<DataType>> Diff(
+    const Tree<DataType>& oldTree, const Tree<DataType>& newTree,
+    const KeyFunctionType& keyFunction, const EqualFunctionType& equalFunction,
+    unsigned int threadCount = std::thread::hardware_concurrency())
+{
+    using NodeType = typename Tree<DataType>::Node;
+
+    std::vector<Edit<DataType>> edits;
+    std::vector<std::pair<const NodeType*, const NodeType*>> topLevelPairs;
+
+    Detail::DiffSubtrees<DataType>(
+        *oldTree.GetRoot(), *newTree.GetRoot(), keyFunction, equalFunction,
+        /* descendIntoChildren = */ false, edits,
+        [&](const NodeType& oldChild, const NodeType& newChild) {
+            topLevelPairs.emplace_back(&oldChild, &newChild);
         });
 
-    graphStream << "}" << std::flush;
+    std::vector<std::vector<Edit<DataType>>> editsPerSubtree(topLevelPairs.size());
+
+    std::atomic<std::size_t> nextPair{ 0 };
+    const auto worker = [&] {
+        for (auto index = nextPair.fetch_add(1); index < topLevelPairs.size();
+             index = nextPair.fetch_add(1)) {
+            const auto [oldChild, newChild] = topLevelPairs[index];
+            Detail::DiffSubtrees<DataType>(
+                *oldChild, *newChild, keyFunction, equalFunction,
+                /* descendIntoChildren = */ true, editsPerSubtree[index],
+                [](const NodeType&, const NodeType&) noexcept {});
+        }
+    };
+
+    const auto workerCount = std::min<std::size_t>(threadCount, topLevelPairs.size());
 
-    std::ofstream outputFile{ fileName, std::ofstream::out };
+    std::vector<std::thread> threads;
+    for (std::size_t index = 1; index < workerCount; ++index) {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (auto& subtreeEdits : editsPerSubtree) {
+        edits.insert(std::end(edits), std::begin(subtreeEdits), std::end(subtreeEdits));
+    }
+
+    Detail::DetectMoves(edits);
+
+    return edits;
+}
+
+/**
+ * @brief Creates a pruned copy of a tree that only contains the Nodes that satisfy the given
+ * predicate, along with their ancestors.
+ *
+ * The source tree is traversed only once, and Nodes are only copied once it's known that they
+ * will survive, so no memory is spent on Nodes that would otherwise have to be deleted again.
+ *
+ * @note The root is always retained. Child indices and subtree hashes are not carried over.
+ *
+ * @param[in] tree                The tree to copy.
+ * @param[in] predicate           A callable that determines whether a Node should be kept. This
+ *                                type should be equivalent to:
+ *                                   bool predicate(const Tree<DataType>::Node& node);
+ *
+ * @returns The pruned copy.
+ */
+template <typename DataType, typename PredicateType>
+Tree<DataType> CopyIf(const Tree<DataType>& tree, const PredicateType& predicate)
+{
+    using NodeType = typename Tree<DataType>::Node;
+
+    const NodeType* const sourceRoot = tree.GetRoot();
+    Tree<DataType> result{ sourceRoot->GetData() };
+
+    // The chain of ancestors leading up to the current Node, paired with their copies. Ancestors
+    // are only copied once one of their descendants is found to match:
+    std::vector<std::pair<const NodeType*, NodeType*>> path{ { sourceRoot, result.GetRoot() } };
+
+    const auto copyPath = [&] {
+        auto firstUncopied = path.size();
+        while (path[firstUncopied - 1].second == nullptr) {
+            --firstUncopied;
+        }
+
+        for (auto index = firstUncopied; index < path.size(); ++index) {
+            path[index].second = path[index - 1].second->AppendChild(path[index].first->GetData());
+        }
+    };
+
+    const NodeType* node = sourceRoot->GetFirstChild();
+    while (node) {
+        path.emplace_back(node, nullptr);
+
+        if (predicate(*node)) {
+            copyPath();
+        }
+
+        if (node->HasChildren()) {
+            node = node->GetFirstChild();
+            continue;
+        }
+
+        while (true) {
+            path.pop_back();
+
+            if (node->GetNextSibling()) {
+                node = node->GetNextSibling();
+                break;
+            }
+
+            node = node->GetParent();
+            if (node == sourceRoot) {
+                node = nullptr;
+                break;
+            }
+        }
+    }
 
-    outputFile << graphStream.rdbuf();
+    return result;
 }
 } // namespace TreeUtilities
@@ -1,11 +1,32 @@
 #define CATCH_CONFIG_MAIN // This tells Catch to provide a main() - only do this in one cpp file
 #include <catch2/catch.hpp>
 
+#include "file_info.h"
+#include "mapped_tree.h"
 #include "tree.h"
+#include "tree_journal.h"
+#include "tree_json.h"
+#include "tree_serialization.h"
+#include "tree_utils.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
 #include <vector>
 
+// Most tests below run on trees of strings, so those opt into all optional Node bookkeeping:
+template <> struct TreeTraits<std::string>
+{
+    static constexpr bool EnableSubtreeHashes = true;
+    static constexpr bool EnableChildIndex = true;
+};
+
 namespace
 {
 namespace Global
@@ -120,6 +141,16 @@ template <typename DataType> void VerifyParentIsIdentical(const Tree<DataType>&
 
     REQUIRE(allNodesHaveIdenticalParent == true);
 }
+
+/**
+ * @brief A string codec that declares a version, so that data written by one version can be
+ * checked against another.
+ */
+template <std::uint32_t CodecVersion>
+struct VersionedStringCodec : TreeUtilities::DefaultCodec<std::string>
+{
+    static constexpr std::uint32_t Version{ CodecVersion };
+};
 } // namespace
 
 TEST_CASE("Node Construction and Assignment")
@@ -749,6 +780,20 @@ TEST_CASE("Tree Copying")
 
         VerifyTraversal(expected, actual);
     }
+
+    SECTION("Assignment")
+    {
+        Tree<std::string> assigned{ "X" };
+        assigned = copy;
+
+        REQUIRE(assigned.Size() == copy.Size());
+        REQUIRE(assigned.GetRoot()->GetData() == "F");
+
+        Tree<int> integers{ 1 };
+        integers = Tree<int>{ 2 };
+
+        REQUIRE(integers.GetRoot()->GetData() == 2);
+    }
 }
 
 TEST_CASE("Selectively Delecting Nodes")
@@ -1170,3 +1215,1447 @@ TEST_CASE("Selectively Delecting Nodes")
         REQUIRE(Global::DestructionCount == treeSize);
     }
 }
+
+TEST_CASE("Hashed Child Lookup")
+{
+    const auto identity = [](const std::string& data) noexcept { return data; };
+
+    Tree<std::string> tree{ "Root" };
+
+    auto* const root = tree.GetRoot();
+    root->EnableChildIndex(identity, /* threshold = */ 4);
+
+    const auto appendChildren = [&](int count) {
+        for (int index = 0; index < count; ++index) {
+            root->AppendChild("Child " + std::to_string(index));
+        }
+    };
+
+    SECTION("Lookup Without an Index")
+    {
+        Tree<std::string> plainTree{ "Root" };
+        plainTree.GetRoot()->AppendChild("A");
+
+        REQUIRE(plainTree.GetRoot()->HasChildIndex() == false);
+        const auto* const plainRoot = plainTree.GetRoot();
+        REQUIRE(plainRoot->FindChild(std::string{ "A" }) == plainRoot->GetFirstChild());
+        REQUIRE(plainRoot->FindChild(std::string{ "B" }) == nullptr);
+    }
+
+    SECTION("Lookup With Convertible Keys")
+    {
+        appendChildren(100);
+
+        const auto* const match = root->FindChild(std::string{ "Child 42" });
+
+        REQUIRE(match != nullptr);
+        REQUIRE(root->FindChild("Child 42") == match);
+        REQUIRE(root->FindChild(std::string_view{ "Child 42" }) == match);
+        REQUIRE(root->FindChild("Child 100") == nullptr);
+    }
+
+    SECTION("Throwing Key Extractor")
+    {
+        Tree<std::string> throwingTree{ "Root" };
+
+        auto* const throwingRoot = throwingTree.GetRoot();
+        throwingRoot->EnableChildIndex(
+            [](const std::string& data) {
+                if (data == "Poison") {
+                    throw std::runtime_error{ "Unhashable key" };
+                }
+
+                return data;
+            },
+            /* threshold = */ 4);
+
+        for (int index = 0; index < 10; ++index) {
+            throwingRoot->AppendChild("Child " + std::to_string(index));
+        }
+
+        // The structural change still goes through, even though the child can't be indexed:
+        throwingRoot->AppendChild("Poison");
+        REQUIRE(throwingRoot->GetChildCount() == 11);
+
+        REQUIRE_THROWS_AS(throwingRoot->FindChild("Child 10"), std::runtime_error);
+
+        throwingRoot->GetLastChild()->DeleteFromTree();
+        throwingRoot->RebuildChildIndex();
+
+        REQUIRE(throwingRoot->FindChild("Child 9") == throwingRoot->GetLastChild());
+        REQUIRE(throwingRoot->FindChild("Child 10") == nullptr);
+    }
+
+    SECTION("Lookup by Extracted Key on Either Side of the Threshold")
+    {
+        Tree<std::string> lengthTree{ "Root" };
+
+        auto* const lengthRoot = lengthTree.GetRoot();
+        lengthRoot->EnableChildIndex(
+            [](const std::string& data) noexcept { return data.size(); }, /* threshold = */ 4);
+
+        lengthRoot->AppendChild("A");
+        lengthRoot->AppendChild("BB");
+
+        const auto* const match = lengthRoot->GetLastChild();
+        REQUIRE(lengthRoot->FindChild(std::size_t{ 2 }) == match);
+
+        for (int index = 0; index < 10; ++index) {
+            lengthRoot->AppendChild(std::string(10 + index, '*'));
+        }
+
+        REQUIRE(lengthRoot->FindChild(std::size_t{ 2 }) == match);
+
+        while (lengthRoot->GetChildCount() > 2) {
+            lengthRoot->GetLastChild()->DeleteFromTree();
+        }
+
+        REQUIRE(lengthRoot->FindChild(std::size_t{ 2 }) == match);
+        REQUIRE(lengthRoot->FindChild(std::size_t{ 10 }) == nullptr);
+    }
+
+    SECTION("Lookup Below the Threshold")
+    {
+        appendChildren(3);
+
+        const auto* const secondChild = root->GetFirstChild()->GetNextSibling();
+
+        REQUIRE(root->HasChildIndex());
+        REQUIRE(root->FindChild(std::string{ "Child 1" }) == secondChild);
+        REQUIRE(root->FindChild(std::string{ "Child 3" }) == nullptr);
+    }
+
+    SECTION("Lookup Above the Threshold")
+    {
+        appendChildren(1000);
+        root->PrependChild("First");
+
+        REQUIRE(root->FindChild(std::string{ "First" }) == root->GetFirstChild());
+        REQUIRE(root->FindChild(std::string{ "Child 999" }) == root->GetLastChild());
+        REQUIRE(root->FindChild(std::string{ "Child 1000" }) == nullptr);
+
+        for (int index = 0; index < 1000; ++index) {
+            const auto key = "Child " + std::to_string(index);
+            REQUIRE(root->FindChild(key)->GetData() == key);
+        }
+    }
+
+    SECTION("Deleting Indexed Children")
+    {
+        appendChildren(100);
+
+        for (int index = 0; index < 100; index += 2) {
+            root->FindChild("Child " + std::to_string(index))->DeleteFromTree();
+        }
+
+        REQUIRE(root->GetChildCount() == 50);
+
+        for (int index = 0; index < 100; ++index) {
+            const auto* const match = root->FindChild("Child " + std::to_string(index));
+            REQUIRE((match != nullptr) == (index % 2 == 1));
+        }
+    }
+
+    SECTION("Repopulating an Emptied Node")
+    {
+        appendChildren(8);
+
+        while (root->HasChildren()) {
+            root->GetFirstChild()->DeleteFromTree();
+        }
+
+        root->AppendChild("x");
+        REQUIRE(root->FindChild("x") == root->GetFirstChild());
+
+        appendChildren(8);
+        REQUIRE(root->FindChild("x") == root->GetFirstChild());
+        REQUIRE(root->FindChild("Child 7") == root->GetLastChild());
+    }
+
+    SECTION("Sorting Indexed Children")
+    {
+        appendChildren(100);
+
+        root->SortChildren([](const auto& lhs, const auto& rhs) noexcept { return lhs > rhs; });
+
+        REQUIRE(root->FindChild(std::string{ "Child 99" }) == root->GetFirstChild());
+        REQUIRE(root->FindChild(std::string{ "Child 0" }) == root->GetLastChild());
+    }
+
+    SECTION("Copying Preserves the Index")
+    {
+        appendChildren(100);
+
+        const auto copy = tree;
+
+        REQUIRE(copy.GetRoot()->HasChildIndex());
+        const auto* const match = copy.GetRoot()->FindChild(std::string{ "Child 50" });
+        REQUIRE(match->GetParent() == copy.GetRoot());
+    }
+}
+
+TEST_CASE("Optional Node Bookkeeping")
+{
+    Tree<int> tree{ 0 };
+    for (int index = 1; index <= 100; ++index) {
+        tree.GetRoot()->AppendChild(index);
+    }
+
+    SECTION("Nodes Without Bookkeeping Are Smaller")
+    {
+        REQUIRE(sizeof(Tree<int>::Node) < sizeof(Tree<std::string>::Node) - sizeof(std::string));
+    }
+
+    SECTION("Subtree Hashes Are Always Stale")
+    {
+        REQUIRE(tree.GetRoot()->IsSubtreeHashStale());
+
+        tree.GetRoot()->GetFirstChild()->InvalidateSubtreeHash();
+        REQUIRE(tree.GetRoot()->GetFirstChild()->IsSubtreeHashStale());
+    }
+
+    SECTION("Lookup Walks the Children")
+    {
+        REQUIRE(tree.GetRoot()->HasChildIndex() == false);
+        REQUIRE(tree.GetRoot()->FindChild(42)->GetData() == 42);
+        REQUIRE(tree.GetRoot()->FindChild(101) == nullptr);
+    }
+
+    SECTION("Diffing Without Hashes")
+    {
+        Tree<int> newTree = tree;
+        newTree.GetRoot()->GetLastChild()->DeleteFromTree();
+
+        const auto key = [](int data) noexcept { return data; };
+        const auto equal = [](int lhs, int rhs) noexcept { return lhs == rhs; };
+
+        const auto edits = TreeUtilities::Diff(tree, newTree, key, equal);
+        REQUIRE(edits.size() == 1);
+        REQUIRE(edits.front().kind == TreeUtilities::EditKind::Removed);
+        REQUIRE(edits.front().oldNode->GetData() == 100);
+    }
+}
+
+TEST_CASE("Subtree Hashing")
+{
+    const auto hasher = [](const std::string& data) noexcept {
+        return static_cast<std::uint64_t>(std::hash<std::string>{}(data));
+    };
+
+    const auto buildTree = [] {
+        Tree<std::string> tree{ "F" };
+        tree.GetRoot()->AppendChild("B")->AppendChild("A");
+        tree.GetRoot()->GetFirstChild()->AppendChild("D")->AppendChild("C");
+        tree.GetRoot()->GetFirstChild()->GetLastChild()->AppendChild("E");
+        tree.GetRoot()->AppendChild("G")->AppendChild("I")->AppendChild("H");
+
+        return tree;
+    };
+
+    Tree<std::string> lhs = buildTree();
+    Tree<std::string> rhs = buildTree();
+
+    SECTION("Hashes Start Out Stale")
+    {
+        REQUIRE(lhs.GetRoot()->IsSubtreeHashStale());
+    }
+
+    SECTION("Identical Trees Hash Identically")
+    {
+        REQUIRE(lhs.UpdateSubtreeHashes(hasher, 1) == rhs.UpdateSubtreeHashes(hasher, 4));
+        REQUIRE(lhs.GetRoot()->IsSubtreeHashStale() == false);
+    }
+
+    SECTION("Sibling Order Doesn't Matter")
+    {
+        rhs.GetRoot()->SortChildren([](const auto& lhs, const auto& rhs) { return lhs > rhs; });
+
+        REQUIRE(lhs.UpdateSubtreeHashes(hasher) == rhs.UpdateSubtreeHashes(hasher));
+    }
+
+    SECTION("Shape Matters")
+    {
+        Tree<std::string> nested{ "A" };
+        nested.GetRoot()->AppendChild("B")->AppendChild("C");
+
+        Tree<std::string> flat{ "A" };
+        flat.GetRoot()->AppendChild("B");
+        flat.GetRoot()->AppendChild("C");
+
+        REQUIRE(nested.UpdateSubtreeHashes(hasher) != flat.UpdateSubtreeHashes(hasher));
+    }
+
+    SECTION("Appending Invalidates Only the Ancestor Chain")
+    {
+        const auto originalHash = lhs.UpdateSubtreeHashes(hasher);
+
+        auto* const nodeD = lhs.GetRoot()->GetFirstChild()->GetLastChild();
+        nodeD->AppendChild("X");
+
+        REQUIRE(lhs.GetRoot()->IsSubtreeHashStale());
+        REQUIRE(nodeD->IsSubtreeHashStale());
+        REQUIRE(nodeD->GetFirstChild()->IsSubtreeHashStale() == false);
+        REQUIRE(lhs.GetRoot()->GetLastChild()->IsSubtreeHashStale() == false);
+
+        REQUIRE(lhs.UpdateSubtreeHashes(hasher) != originalHash);
+
+        nodeD->GetLastChild()->DeleteFromTree();
+
+        REQUIRE(lhs.UpdateSubtreeHashes(hasher) == originalHash);
+    }
+
+    SECTION("Data Edits Require Explicit Invalidation")
+    {
+        const auto originalHash = lhs.UpdateSubtreeHashes(hasher);
+
+        auto* const nodeH = lhs.GetRoot()->GetLastChild()->GetFirstChild()->GetFirstChild();
+        nodeH->GetData() = "Z";
+        nodeH->InvalidateSubtreeHash();
+
+        REQUIRE(lhs.UpdateSubtreeHashes(hasher) != originalHash);
+        REQUIRE(
+            lhs.GetRoot()->GetFirstChild()->GetSubtreeHash() ==
+            rhs.GetRoot()->GetFirstChild()->UpdateSubtreeHash(hasher));
+    }
+
+    SECTION("Parallel and Serial Hashing Agree on Large Trees")
+    {
+        Tree<std::string> wide{ "Root" };
+        for (int outer = 0; outer < 50; ++outer) {
+            auto* const child = wide.GetRoot()->AppendChild(std::to_string(outer));
+            for (int inner = 0; inner < 50; ++inner) {
+                child->AppendChild(std::to_string(inner));
+            }
+        }
+
+        auto copy = wide;
+
+        REQUIRE(wide.UpdateSubtreeHashes(hasher, 8) == copy.GetRoot()->UpdateSubtreeHash(hasher));
+    }
+}
+
+TEST_CASE("Tree Diffing")
+{
+    using NodeType = Tree<std::string>::Node;
+    using EditType = TreeUtilities::Edit<std::string>;
+
+    const auto key = [](const std::string& data) noexcept { return data.substr(0, 1); };
+    const auto equal = [](const std::string& lhs, const std::string& rhs) noexcept {
+        return lhs == rhs;
+    };
+    const auto hasher = [](const std::string& data) noexcept {
+        return static_cast<std::uint64_t>(std::hash<std::string>{}(data));
+    };
+
+    Tree<std::string> oldTree{ "F" };
+    oldTree.GetRoot()->AppendChild("B")->AppendChild("A");
+    oldTree.GetRoot()->GetFirstChild()->AppendChild("D")->AppendChild("C");
+    oldTree.GetRoot()->GetFirstChild()->GetLastChild()->AppendChild("E");
+    oldTree.GetRoot()->AppendChild("G")->AppendChild("I")->AppendChild("H");
+
+    Tree<std::string> newTree = oldTree;
+
+    const auto countEdits = [](const std::vector<EditType>& edits, TreeUtilities::EditKind kind) {
+        return std::count_if(std::begin(edits), std::end(edits), [&](const EditType& edit) {
+            return edit.kind == kind;
+        });
+    };
+
+    SECTION("Identical Trees")
+    {
+        REQUIRE(TreeUtilities::Diff(oldTree, newTree, key, equal).empty());
+
+        oldTree.UpdateSubtreeHashes(hasher);
+        newTree.UpdateSubtreeHashes(hasher);
+
+        REQUIRE(TreeUtilities::Diff(oldTree, newTree, key, equal).empty());
+    }
+
+    SECTION("Additions, Removals and Modifications")
+    {
+        NodeType* const nodeD = newTree.GetRoot()->GetFirstChild()->GetLastChild();
+        nodeD->GetFirstChild()->GetData() = "C2";
+        nodeD->GetLastChild()->DeleteFromTree();
+        nodeD->AppendChild("X")->AppendChild("Y");
+
+        const auto edits = TreeUtilities::Diff(oldTree, newTree, key, equal, 4);
+
+        REQUIRE(edits.size() == 3);
+        REQUIRE(countEdits(edits, TreeUtilities::EditKind::Modified) == 1);
+        REQUIRE(countEdits(edits, TreeUtilities::EditKind::Added) == 1);
+        REQUIRE(countEdits(edits, TreeUtilities::EditKind::Removed) == 1);
+
+        const auto added = std::find_if(std::begin(edits), std::end(edits), [](const auto& edit) {
+            return edit.kind == TreeUtilities::EditKind::Added;
+        });
+
+        REQUIRE(added->oldNode == nullptr);
+        REQUIRE(added->newNode->GetData() == "X");
+    }
+
+    SECTION("Moves Are Detected with Subtree Hashes")
+    {
+        auto* const nodeI = newTree.GetRoot()->GetLastChild()->GetFirstChild();
+        newTree.GetRoot()->GetFirstChild()->AppendChild("I")->AppendChild("H");
+        nodeI->DeleteFromTree();
+
+        const auto unhashedEdits = TreeUtilities::Diff(oldTree, newTree, key, equal);
+
+        REQUIRE(countEdits(unhashedEdits, TreeUtilities::EditKind::Moved) == 0);
+
+        oldTree.UpdateSubtreeHashes(hasher);
+        newTree.UpdateSubtreeHashes(hasher);
+
+        const auto hashedEdits = TreeUtilities::Diff(oldTree, newTree, key, equal);
+
+        REQUIRE(hashedEdits.size() == 1);
+        REQUIRE(hashedEdits.front().kind == TreeUtilities::EditKind::Moved);
+        REQUIRE(hashedEdits.front().oldNode->GetParent()->GetData() == "G");
+        REQUIRE(hashedEdits.front().newNode->GetParent()->GetData() == "B");
+    }
+}
+
+TEST_CASE("Filtered Tree Copying")
+{
+    Tree<int> tree{ 0 };
+    tree.GetRoot()->AppendChild(1)->AppendChild(10);
+    tree.GetRoot()->GetFirstChild()->AppendChild(2)->AppendChild(20);
+    tree.GetRoot()->GetFirstChild()->GetLastChild()->AppendChild(3);
+    tree.GetRoot()->AppendChild(4)->AppendChild(5)->AppendChild(6);
+
+    const auto copyAndFlatten = [&](const auto& predicate) {
+        const auto copy = TreeUtilities::CopyIf(tree, predicate);
+
+        std::vector<int> actual;
+        std::transform(
+            copy.beginPreOrder(), copy.endPreOrder(), std::back_inserter(actual),
+            [](const auto& node) noexcept { return node.GetData(); });
+
+        return actual;
+    };
+
+    SECTION("Keeping Everything")
+    {
+        const auto actual = copyAndFlatten([](const auto&) noexcept { return true; });
+        const std::vector<int> expected = { 0, 1, 10, 2, 20, 3, 4, 5, 6 };
+
+        VerifyTraversal(expected, actual);
+    }
+
+    SECTION("Keeping Nothing but the Root")
+    {
+        const auto actual = copyAndFlatten([](const auto&) noexcept { return false; });
+        const std::vector<int> expected = { 0 };
+
+        VerifyTraversal(expected, actual);
+    }
+
+    SECTION("Keeping Matches and Their Ancestors")
+    {
+        const auto actual =
+            copyAndFlatten([](const auto& node) noexcept { return node.GetData() >= 10; });
+        const std::vector<int> expected = { 0, 1, 10, 2, 20 };
+
+        VerifyTraversal(expected, actual);
+    }
+
+    SECTION("Keeping Deeply Nested Matches")
+    {
+        const auto actual =
+            copyAndFlatten([](const auto& node) noexcept { return node.GetData() % 3 == 0; });
+        const std::vector<int> expected = { 0, 1, 2, 3, 4, 5, 6 };
+
+        VerifyTraversal(expected, actual);
+    }
+}
+
+TEST_CASE("Splicing Subtrees")
+{
+    Tree<std::string> tree{ "F" };
+    tree.GetRoot()->AppendChild("B")->AppendChild("A");
+    tree.GetRoot()->GetFirstChild()->AppendChild("D")->AppendChild("C");
+    tree.GetRoot()->GetFirstChild()->GetLastChild()->AppendChild("E");
+    tree.GetRoot()->AppendChild("G")->AppendChild("I")->AppendChild("H");
+
+    auto* const nodeB = tree.GetRoot()->GetFirstChild();
+    auto* const nodeD = nodeB->GetLastChild();
+    auto* const nodeG = tree.GetRoot()->GetLastChild();
+
+    const auto flatten = [](const Tree<std::string>& tree) {
+        std::vector<std::string> actual;
+        std::transform(
+            tree.beginPreOrder(), tree.endPreOrder(), std::back_inserter(actual),
+            [](const auto& node) noexcept { return node.GetData(); });
+
+        return actual;
+    };
+
+    SECTION("Detaching a Subtree")
+    {
+        std::unique_ptr<Tree<std::string>::Node> detached{ nodeD->Detach() };
+
+        REQUIRE(detached->GetParent() == nullptr);
+        REQUIRE(detached->GetPreviousSibling() == nullptr);
+        REQUIRE(nodeB->GetChildCount() == 1);
+        REQUIRE(nodeB->GetLastChild()->GetNextSibling() == nullptr);
+
+        const std::vector<std::string> expected = { "F", "B", "A", "G", "I", "H" };
+        VerifyTraversal(expected, flatten(tree));
+    }
+
+    SECTION("Moving a Subtree to Another Parent")
+    {
+        nodeG->Splice(*nodeD, nodeG->GetFirstChild());
+
+        REQUIRE(nodeD->GetParent() == nodeG);
+        REQUIRE(nodeB->GetChildCount() == 1);
+        REQUIRE(nodeG->GetChildCount() == 2);
+
+        const std::vector<std::string> expected = { "F", "B", "A", "G", "D", "C", "E", "I", "H" };
+        VerifyTraversal(expected, flatten(tree));
+    }
+
+    SECTION("Reordering Siblings")
+    {
+        nodeB->AppendChild("Z");
+        nodeB->Splice(*nodeB->GetLastChild(), nodeD);
+
+        REQUIRE(nodeB->GetChildCount() == 3);
+        REQUIRE(nodeB->GetFirstChild()->GetPreviousSibling() == nullptr);
+        REQUIRE(nodeB->GetLastChild() == nodeD);
+
+        const std::vector<std::string> expected = { "F", "B", "A", "Z", "D",
+                                                    "C", "E", "G", "I", "H" };
+        VerifyTraversal(expected, flatten(tree));
+    }
+
+    SECTION("Appending an Attached Node Moves It")
+    {
+        tree.GetRoot()->AppendChild(*nodeD);
+
+        REQUIRE(nodeB->GetChildCount() == 1);
+        REQUIRE(tree.GetRoot()->GetChildCount() == 3);
+        REQUIRE(nodeD->GetNextSibling() == nullptr);
+        REQUIRE(nodeD->GetPreviousSibling() == nodeG);
+    }
+
+    SECTION("Extracting and Re-Splicing a Subtree")
+    {
+        auto extracted = Tree<std::string>::Extract(*nodeD);
+
+        REQUIRE(extracted.GetRoot() == nodeD);
+        REQUIRE(extracted.Size() == 3);
+        REQUIRE(tree.Size() == 6);
+
+        tree.GetRoot()->Splice(std::move(extracted), nodeB);
+
+        REQUIRE(extracted.GetRoot() == nullptr);
+        REQUIRE(tree.GetRoot()->GetFirstChild() == nodeD);
+
+        const std::vector<std::string> expected = { "F", "D", "C", "E", "B", "A", "G", "I", "H" };
+        VerifyTraversal(expected, flatten(tree));
+    }
+
+    SECTION("Splicing Keeps Child Indices Current")
+    {
+        const auto identity = [](const std::string& data) noexcept { return data; };
+        nodeG->EnableChildIndex(identity, /* threshold = */ 1);
+        nodeG->AppendChild("J");
+
+        nodeG->Splice(*nodeD);
+
+        REQUIRE(nodeG->FindChild(std::string{ "D" }) == nodeD);
+
+        nodeB->Splice(*nodeD);
+
+        REQUIRE(nodeG->FindChild(std::string{ "D" }) == nullptr);
+        REQUIRE(nodeG->FindChild(std::string{ "J" }) != nullptr);
+    }
+}
+
+TEST_CASE("Binary Serialization")
+{
+    Tree<std::string> tree{ "F" };
+    tree.GetRoot()->AppendChild("B")->AppendChild("A");
+    tree.GetRoot()->GetFirstChild()->AppendChild("D")->AppendChild("C");
+    tree.GetRoot()->GetFirstChild()->GetLastChild()->AppendChild("E");
+    tree.GetRoot()->AppendChild("G")->AppendChild("I")->AppendChild("H");
+
+    std::stringstream stream{ std::ios::in | std::ios::out | std::ios::binary };
+
+    SECTION("Round-Tripping a Tree of Strings")
+    {
+        REQUIRE(TreeUtilities::Save(tree, stream));
+
+        const auto loaded = TreeUtilities::Load<std::string>(stream);
+        REQUIRE(loaded.has_value());
+
+        const std::vector<std::string> expected = { "F", "B", "A", "D", "C", "E", "G", "I", "H" };
+
+        std::vector<std::string> actual;
+        std::transform(
+            loaded->beginPreOrder(), loaded->endPreOrder(), std::back_inserter(actual),
+            [](const auto& node) noexcept { return node.GetData(); });
+
+        VerifyTraversal(expected, actual);
+    }
+
+    SECTION("Round-Tripping a Wide Tree of Integers")
+    {
+        Tree<std::uint32_t> wideTree{ 0 };
+        for (std::uint32_t index = 1; index <= 100'000; ++index) {
+            wideTree.GetRoot()->AppendChild(index);
+        }
+
+        REQUIRE(TreeUtilities::Save(wideTree, stream));
+
+        const auto loaded = TreeUtilities::Load<std::uint32_t>(stream);
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->GetRoot()->GetChildCount() == 100'000);
+        REQUIRE(loaded->GetRoot()->GetLastChild()->GetData() == 100'000);
+    }
+
+    SECTION("Arithmetic Types Are Stored in Little-Endian Order")
+    {
+        Tree<std::int16_t> signedTree{ -2 };
+        REQUIRE(TreeUtilities::Save(signedTree, stream));
+
+        // The header is followed by the root's child count, and then by its data:
+        const auto serialized = stream.str();
+        REQUIRE(serialized.size() == 15);
+        REQUIRE(static_cast<unsigned char>(serialized[13]) == 0xFE);
+        REQUIRE(static_cast<unsigned char>(serialized[14]) == 0xFF);
+
+        const auto loaded = TreeUtilities::Load<std::int16_t>(stream);
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->GetRoot()->GetData() == -2);
+    }
+
+    SECTION("Round-Tripping Floating-Point Numbers")
+    {
+        Tree<double> doubleTree{ -0.5 };
+        doubleTree.GetRoot()->AppendChild(3.25);
+
+        REQUIRE(TreeUtilities::Save(doubleTree, stream));
+
+        const auto loaded = TreeUtilities::Load<double>(stream);
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->GetRoot()->GetData() == -0.5);
+        REQUIRE(loaded->GetRoot()->GetFirstChild()->GetData() == 3.25);
+    }
+
+    SECTION("Using a Custom Codec")
+    {
+        struct LengthCodec
+        {
+            void Encode(TreeUtilities::BinaryWriter& writer, const std::string& data) const
+            {
+                writer.WriteVarint(data.size());
+            }
+
+            std::string Decode(TreeUtilities::BinaryReader& reader) const
+            {
+                return std::string(static_cast<std::size_t>(reader.ReadVarint()), '*');
+            }
+        };
+
+        REQUIRE(TreeUtilities::Save(tree, stream, LengthCodec{}));
+
+        const auto loaded = TreeUtilities::Load<std::string>(stream, LengthCodec{});
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->Size() == tree.Size());
+        REQUIRE(loaded->GetRoot()->GetData() == "*");
+    }
+
+    SECTION("Rejecting Data Written by Another Version of the Codec")
+    {
+        using OldCodec = VersionedStringCodec<1>;
+        using NewCodec = VersionedStringCodec<2>;
+
+        REQUIRE(TreeUtilities::Save(tree, stream, OldCodec{}));
+        const auto serialized = stream.str();
+
+        std::stringstream oldStream{ serialized };
+        REQUIRE(TreeUtilities::Load<std::string>(oldStream, OldCodec{}).has_value());
+
+        std::stringstream newStream{ serialized };
+        REQUIRE(TreeUtilities::Load<std::string>(newStream, NewCodec{}).has_value() == false);
+
+        std::stringstream unversionedStream{ serialized };
+        REQUIRE(TreeUtilities::Load<std::string>(unversionedStream).has_value() == false);
+    }
+
+    SECTION("Rejecting Malformed Input")
+    {
+        std::stringstream garbage{ "This isn't a tree." };
+        REQUIRE(TreeUtilities::Load<std::string>(garbage).has_value() == false);
+    }
+
+    SECTION("Rejecting Truncated Input")
+    {
+        REQUIRE(TreeUtilities::Save(tree, stream));
+
+        auto serialized = stream.str();
+        serialized.resize(serialized.size() - 3);
+
+        std::stringstream truncated{ serialized };
+        REQUIRE(TreeUtilities::Load<std::string>(truncated).has_value() == false);
+    }
+}
+
+TEST_CASE("Memory-Mapped Trees")
+{
+    struct MappedCodec
+    {
+        std::string_view Name(const std::string& data) const noexcept
+        {
+            return data;
+        }
+
+        std::uint32_t Payload(const std::string& data) const noexcept
+        {
+            return static_cast<std::uint32_t>(data.front());
+        }
+    };
+
+    using MappedTreeType = TreeUtilities::MappedTree<std::uint32_t>;
+
+    Tree<std::string> tree{ "F" };
+    tree.GetRoot()->AppendChild("B")->AppendChild("A");
+    tree.GetRoot()->GetFirstChild()->AppendChild("D")->AppendChild("C");
+    tree.GetRoot()->GetFirstChild()->GetLastChild()->AppendChild("E");
+    tree.GetRoot()->AppendChild("G")->AppendChild("I")->AppendChild("H");
+
+    const auto path = std::filesystem::temp_directory_path() / "mapped_tree_test.bin";
+
+    {
+        std::ofstream stream{ path, std::ios::binary };
+        REQUIRE(TreeUtilities::SaveMapped(tree, stream, MappedCodec{}));
+    }
+
+    const auto mappedTree = MappedTreeType::Open(path);
+    REQUIRE(mappedTree.has_value());
+
+    const auto collectNames = [](auto begin, auto end) {
+        std::vector<std::string> names;
+        std::transform(begin, end, std::back_inserter(names), [](const auto& node) {
+            return std::string{ node.GetName() };
+        });
+
+        return names;
+    };
+
+    SECTION("Node Accessors")
+    {
+        const auto root = mappedTree->GetRoot();
+
+        REQUIRE(mappedTree->Size() == 9);
+        REQUIRE(root.GetName() == "F");
+        REQUIRE(root.GetData() == 'F');
+        REQUIRE(root.GetChildCount() == 2);
+        REQUIRE(root.CountAllDescendants() == 8);
+        REQUIRE(!root.GetParent());
+        REQUIRE(!root.GetNextSibling());
+        REQUIRE(root.GetFirstChild().GetName() == "B");
+        REQUIRE(root.GetLastChild().GetName() == "G");
+        REQUIRE(root.GetLastChild().GetPreviousSibling() == root.GetFirstChild());
+        REQUIRE(root.GetFirstChild().GetLastChild().GetParent() == root.GetFirstChild());
+    }
+
+    SECTION("Pre-Order Traversal")
+    {
+        const std::vector<std::string> expected = { "F", "B", "A", "D", "C", "E", "G", "I", "H" };
+        VerifyTraversal(
+            expected, collectNames(mappedTree->beginPreOrder(), mappedTree->endPreOrder()));
+    }
+
+    SECTION("Post-Order Traversal")
+    {
+        const std::vector<std::string> expected = { "A", "C", "E", "D", "B", "H", "I", "G", "F" };
+        VerifyTraversal(expected, collectNames(mappedTree->begin(), mappedTree->end()));
+    }
+
+    SECTION("Leaf Traversal")
+    {
+        const std::vector<std::string> expected = { "A", "C", "E", "H" };
+        VerifyTraversal(expected, collectNames(mappedTree->beginLeaf(), mappedTree->endLeaf()));
+    }
+
+    SECTION("Partial Traversals")
+    {
+        const auto nodeD = mappedTree->GetRoot().GetFirstChild().GetLastChild();
+
+        const std::vector<std::string> expectedPreOrder = { "D", "C", "E" };
+        VerifyTraversal(
+            expectedPreOrder, collectNames(
+                                  MappedTreeType::PreOrderIterator{ nodeD },
+                                  MappedTreeType::PreOrderIterator{}));
+
+        const std::vector<std::string> expectedPostOrder = { "C", "E", "D" };
+        VerifyTraversal(
+            expectedPostOrder, collectNames(
+                                   MappedTreeType::PostOrderIterator{ nodeD },
+                                   MappedTreeType::PostOrderIterator{}));
+
+        const std::vector<std::string> expectedSiblings = { "B", "G" };
+        VerifyTraversal(
+            expectedSiblings, collectNames(
+                                  MappedTreeType::SiblingIterator{ nodeD.GetParent() },
+                                  MappedTreeType::SiblingIterator{}));
+    }
+
+    SECTION("Handles Outliving a Move")
+    {
+        auto source = MappedTreeType::Open(path);
+        REQUIRE(source.has_value());
+
+        const auto nodeD = source->GetRoot().GetFirstChild().GetLastChild();
+        auto iterator = source->beginPreOrder();
+
+        const MappedTreeType destination{ std::move(*source) };
+        source.reset();
+
+        REQUIRE(nodeD.GetName() == "D");
+        REQUIRE(nodeD.GetParent() == destination.GetRoot().GetFirstChild());
+        REQUIRE((++iterator)->GetName() == "B");
+    }
+
+    SECTION("Rejecting Mismatched Payloads")
+    {
+        REQUIRE(TreeUtilities::MappedTree<std::uint64_t>::Open(path).has_value() == false);
+    }
+
+    SECTION("Validating Every Record")
+    {
+        constexpr auto validateAll = TreeUtilities::MappedValidation::AllRecords;
+        REQUIRE(MappedTreeType::Open(path, validateAll));
+
+        std::string contents;
+        {
+            std::ifstream stream{ path, std::ios::binary };
+            contents.assign(std::istreambuf_iterator<char>{ stream }, {});
+        }
+
+        const auto corruptedPath = std::filesystem::temp_directory_path() / "mapped_tree_bad.bin";
+        const auto writeCorruptedRecord = [&](std::size_t fieldOffset, std::uint32_t value) {
+            // The second record, "B", starts right after the header and the root's record:
+            const auto recordOffset =
+                sizeof(TreeUtilities::Detail::MappedHeader) +
+                TreeUtilities::Detail::MappedRecordSize<std::uint32_t>();
+
+            auto corrupted = contents;
+            std::memcpy(&corrupted[recordOffset + fieldOffset], &value, sizeof(value));
+
+            std::ofstream stream{ corruptedPath, std::ios::binary };
+            stream.write(corrupted.data(), static_cast<std::streamsize>(corrupted.size()));
+        };
+
+        using TreeUtilities::Detail::MappedRecord;
+
+        // A sibling link that points back at the record itself would loop forever:
+        writeCorruptedRecord(offsetof(MappedRecord, nextSibling), 1);
+        REQUIRE(MappedTreeType::Open(corruptedPath));
+        REQUIRE_FALSE(MappedTreeType::Open(corruptedPath, validateAll));
+
+        // A subtree that extends past the end of the tree would be read out of bounds:
+        writeCorruptedRecord(offsetof(MappedRecord, subtreeSize), 100);
+        REQUIRE_FALSE(MappedTreeType::Open(corruptedPath, validateAll));
+
+        // As would a name that extends past the end of the string section:
+        writeCorruptedRecord(offsetof(MappedRecord, nameLength), 100);
+        REQUIRE_FALSE(MappedTreeType::Open(corruptedPath, validateAll));
+
+        std::filesystem::remove(corruptedPath);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("DOT Output")
+{
+    Tree<std::string> tree{ "F" };
+    tree.GetRoot()->AppendChild("B")->AppendChild("A");
+    tree.GetRoot()->GetFirstChild()->AppendChild("D")->AppendChild("C");
+    tree.GetRoot()->GetFirstChild()->GetLastChild()->AppendChild("E");
+    tree.GetRoot()->AppendChild("G")->AppendChild("I")->AppendChild("H");
+
+    std::stringstream stream;
+    TreeUtilities::OutputToDot(tree, stream);
+
+    const std::string expected = "digraph {\n"
+                                 "   rankdir = TB;\n"
+                                 "   edge [arrowsize=0.4, fontsize=10]\n"
+                                 "\n"
+                                 "   0 [label = \"F\"]\n"
+                                 "   1 [label = \"B\"]\n"
+                                 "   0 -> 1\n"
+                                 "   2 [label = \"A\"]\n"
+                                 "   1 -> 2\n"
+                                 "   3 [label = \"D\"]\n"
+                                 "   1 -> 3\n"
+                                 "   4 [label = \"C\"]\n"
+                                 "   3 -> 4\n"
+                                 "   5 [label = \"E\"]\n"
+                                 "   3 -> 5\n"
+                                 "   6 [label = \"G\"]\n"
+                                 "   0 -> 6\n"
+                                 "   7 [label = \"I\"]\n"
+                                 "   6 -> 7\n"
+                                 "   8 [label = \"H\"]\n"
+                                 "   7 -> 8\n"
+                                 "}\n";
+
+    REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Level-of-Detail DOT Output")
+{
+    Tree<std::string> tree{ "F" };
+    tree.GetRoot()->AppendChild("B")->AppendChild("A");
+    tree.GetRoot()->GetFirstChild()->AppendChild("D")->AppendChild("C");
+    tree.GetRoot()->GetFirstChild()->GetLastChild()->AppendChild("E");
+    tree.GetRoot()->AppendChild("G")->AppendChild("I")->AppendChild("H");
+
+    const std::string header = "digraph {\n"
+                               "   rankdir = TB;\n"
+                               "   edge [arrowsize=0.4, fontsize=10]\n"
+                               "\n";
+
+    const std::string summaryStyle = "\", shape = box, style = dashed]\n";
+
+    SECTION("Without Limits")
+    {
+        std::stringstream limitedStream;
+        TreeUtilities::OutputToDot(tree, limitedStream, TreeUtilities::DotOptions<std::string>{});
+
+        std::stringstream unlimitedStream;
+        TreeUtilities::OutputToDot(tree, unlimitedStream);
+
+        REQUIRE(limitedStream.str() == unlimitedStream.str());
+    }
+
+    SECTION("Limiting Depth")
+    {
+        TreeUtilities::DotOptions<std::string> options;
+        options.maximumDepth = 1;
+
+        std::stringstream stream;
+        TreeUtilities::OutputToDot(tree, stream, options);
+
+        const std::string expected = header + "   0 [label = \"F\"]\n"
+                                              "   1 [label = \"B\"]\n"
+                                              "   0 -> 1\n"
+                                              "   2 [label = \"4 more nodes" +
+                                     summaryStyle +
+                                     "   1 -> 2\n"
+                                     "   3 [label = \"G\"]\n"
+                                     "   0 -> 3\n"
+                                     "   4 [label = \"2 more nodes" +
+                                     summaryStyle + "   3 -> 4\n}\n";
+
+        REQUIRE(stream.str() == expected);
+    }
+
+    SECTION("Limiting Children")
+    {
+        TreeUtilities::DotOptions<std::string> options;
+        options.maximumChildren = 1;
+
+        std::stringstream stream;
+        TreeUtilities::OutputToDot(tree, stream, options);
+
+        const std::string expected = header + "   0 [label = \"F\"]\n"
+                                              "   1 [label = \"B\"]\n"
+                                              "   0 -> 1\n"
+                                              "   2 [label = \"A\"]\n"
+                                              "   1 -> 2\n"
+                                              "   3 [label = \"3 more nodes" +
+                                     summaryStyle +
+                                     "   1 -> 3\n"
+                                     "   4 [label = \"3 more nodes" +
+                                     summaryStyle + "   0 -> 4\n}\n";
+
+        REQUIRE(stream.str() == expected);
+    }
+
+    SECTION("Collapsing Subtrees with a Custom Summary")
+    {
+        struct LabelSummary
+        {
+            void Add(const Tree<std::string>::Node& node)
+            {
+                labels += node.GetData();
+            }
+
+            void Write(std::ostream& stream) const
+            {
+                stream << "collapsed " << labels;
+            }
+
+            std::string labels;
+        };
+
+        TreeUtilities::DotOptions<std::string> options;
+        options.shouldCollapse = [](const Tree<std::string>::Node& node) {
+            return node.GetData() == "D" || node.GetData() == "I";
+        };
+
+        std::stringstream stream;
+        TreeUtilities::OutputToDot(tree, stream, options, LabelSummary{});
+
+        const std::string expected = header + "   0 [label = \"F\"]\n"
+                                              "   1 [label = \"B\"]\n"
+                                              "   0 -> 1\n"
+                                              "   2 [label = \"A\"]\n"
+                                              "   1 -> 2\n"
+                                              "   3 [label = \"collapsed DCE" +
+                                     summaryStyle +
+                                     "   1 -> 3\n"
+                                     "   4 [label = \"G\"]\n"
+                                     "   0 -> 4\n"
+                                     "   5 [label = \"collapsed IH" +
+                                     summaryStyle + "   4 -> 5\n}\n";
+
+        REQUIRE(stream.str() == expected);
+    }
+}
+
+TEST_CASE("JSON Serialization")
+{
+    Tree<std::string> tree{ "F" };
+    tree.GetRoot()->AppendChild("B")->AppendChild("A");
+    tree.GetRoot()->GetFirstChild()->AppendChild("D")->AppendChild("C");
+    tree.GetRoot()->GetFirstChild()->GetLastChild()->AppendChild("E");
+    tree.GetRoot()->AppendChild("G")->AppendChild("I")->AppendChild("H");
+
+    const std::vector<std::string> expected = { "F", "B", "A", "D", "C", "E", "G", "I", "H" };
+
+    const auto collectPreOrder = [](const Tree<std::string>& source) {
+        std::vector<std::string> actual;
+        std::transform(
+            source.beginPreOrder(), source.endPreOrder(), std::back_inserter(actual),
+            [](const auto& node) noexcept { return node.GetData(); });
+
+        return actual;
+    };
+
+    std::stringstream stream;
+
+    SECTION("Writing Nested JSON")
+    {
+        Tree<std::string> smallTree{ "A" };
+        smallTree.GetRoot()->AppendChild("B")->AppendChild("C");
+        smallTree.GetRoot()->AppendChild("D");
+
+        REQUIRE(TreeUtilities::WriteJson(smallTree, stream));
+        REQUIRE(
+            stream.str() == "{\"data\":\"A\",\"children\":[{\"data\":\"B\",\"children\":"
+                            "[{\"data\":\"C\"}]},{\"data\":\"D\"}]}\n");
+    }
+
+    SECTION("Writing NDJSON")
+    {
+        Tree<std::string> smallTree{ "A" };
+        smallTree.GetRoot()->AppendChild("B")->AppendChild("C");
+        smallTree.GetRoot()->AppendChild("D");
+
+        REQUIRE(TreeUtilities::WriteJson(
+            smallTree, stream, TreeUtilities::JsonLayout::NewlineDelimited));
+
+        REQUIRE(
+            stream.str() == "{\"id\":0,\"parent\":null,\"data\":\"A\"}\n"
+                            "{\"id\":1,\"parent\":0,\"data\":\"B\"}\n"
+                            "{\"id\":2,\"parent\":1,\"data\":\"C\"}\n"
+                            "{\"id\":3,\"parent\":0,\"data\":\"D\"}\n");
+    }
+
+    SECTION("Round-Tripping Nested JSON")
+    {
+        REQUIRE(TreeUtilities::WriteJson(tree, stream));
+
+        const auto loaded = TreeUtilities::ReadJson<std::string>(stream);
+        REQUIRE(loaded.has_value());
+
+        VerifyTraversal(expected, collectPreOrder(*loaded));
+    }
+
+    SECTION("Round-Tripping NDJSON")
+    {
+        const auto layout = TreeUtilities::JsonLayout::NewlineDelimited;
+        REQUIRE(TreeUtilities::WriteJson(tree, stream, layout));
+
+        const auto loaded = TreeUtilities::ReadJson<std::string>(stream, layout);
+        REQUIRE(loaded.has_value());
+
+        VerifyTraversal(expected, collectPreOrder(*loaded));
+    }
+
+    SECTION("Round-Tripping Strings That Need Escaping")
+    {
+        const std::string awkward = "quote \" backslash \\ newline \n tab \t bell \a caf\xC3\xA9";
+
+        Tree<std::string> awkwardTree{ awkward };
+        REQUIRE(TreeUtilities::WriteJson(awkwardTree, stream));
+        REQUIRE(stream.str().find('\n') == stream.str().size() - 1);
+
+        const auto loaded = TreeUtilities::ReadJson<std::string>(stream);
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->GetRoot()->GetData() == awkward);
+    }
+
+    SECTION("Reading Unicode Escapes")
+    {
+        stream << R"({"data": "é😀\/"})";
+
+        const auto loaded = TreeUtilities::ReadJson<std::string>(stream);
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->GetRoot()->GetData() == "\xC3\xA9\xF0\x9F\x98\x80/");
+    }
+
+    SECTION("Skipping Unknown Members and Whitespace")
+    {
+        stream << R"( { "extra": { "nested": [1, 2.5, true, null, "x"] },
+                        "data": 1,
+                        "children": [ { "data": 2, "ignored": false }, { "data": 3 } ],
+                        "trailing": [] } )";
+
+        const auto loaded = TreeUtilities::ReadJson<int>(stream);
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->GetRoot()->GetData() == 1);
+        REQUIRE(loaded->GetRoot()->GetChildCount() == 2);
+        REQUIRE(loaded->GetRoot()->GetLastChild()->GetData() == 3);
+    }
+
+    SECTION("Round-Tripping a Wide Tree of Integers")
+    {
+        Tree<std::int64_t> wideTree{ -1 };
+        for (std::int64_t index = 1; index <= 100'000; ++index) {
+            wideTree.GetRoot()->AppendChild(index * 1'000'000'007);
+        }
+
+        const auto layout = TreeUtilities::JsonLayout::NewlineDelimited;
+        REQUIRE(TreeUtilities::WriteJson(wideTree, stream, layout));
+
+        const auto loaded = TreeUtilities::ReadJson<std::int64_t>(stream, layout);
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->GetRoot()->GetData() == -1);
+        REQUIRE(loaded->GetRoot()->GetChildCount() == 100'000);
+        REQUIRE(loaded->GetRoot()->GetLastChild()->GetData() == 100'000 * 1'000'000'007ll);
+    }
+
+    SECTION("Round-Tripping a Deep Tree")
+    {
+        Tree<double> deepTree{ 0.5 };
+
+        auto* node = deepTree.GetRoot();
+        for (int index = 1; index <= 10'000; ++index) {
+            node = node->AppendChild(index + 0.25);
+        }
+
+        REQUIRE(TreeUtilities::WriteJson(deepTree, stream));
+
+        const auto loaded = TreeUtilities::ReadJson<double>(stream);
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->Size() == 10'001);
+        REQUIRE(loaded->beginLeaf()->GetData() == 10'000.25);
+    }
+
+    SECTION("Using a Custom Codec")
+    {
+        struct PairCodec
+        {
+            void Encode(TreeUtilities::JsonWriter& writer, const std::pair<int, bool>& data) const
+            {
+                writer.BeginObject();
+                writer.Key("number");
+                writer.Integer(data.first);
+                writer.Key("flag");
+                writer.Bool(data.second);
+                writer.EndObject();
+            }
+
+            std::pair<int, bool> Decode(TreeUtilities::JsonReader& reader) const
+            {
+                std::pair<int, bool> data{ 0, false };
+
+                std::string key;
+                reader.BeginObject();
+                while (reader.NextKey(key)) {
+                    if (key == "number") {
+                        data.first = reader.ReadInteger<int>();
+                    } else if (key == "flag") {
+                        data.second = reader.ReadBool();
+                    } else {
+                        reader.SkipValue();
+                    }
+                }
+
+                return data;
+            }
+        };
+
+        Tree<std::pair<int, bool>> pairTree{ { 1, true } };
+        pairTree.GetRoot()->AppendChild({ 2, false });
+
+        REQUIRE(TreeUtilities::WriteJson(pairTree, stream, {}, PairCodec{}));
+
+        const auto loaded = TreeUtilities::ReadJson<std::pair<int, bool>>(stream, {}, PairCodec{});
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->GetRoot()->GetData() == std::make_pair(1, true));
+        REQUIRE(loaded->GetRoot()->GetFirstChild()->GetData() == std::make_pair(2, false));
+    }
+
+    SECTION("Rejecting Malformed Input")
+    {
+        const auto layout = TreeUtilities::JsonLayout::NewlineDelimited;
+
+        SECTION("Truncated Document")
+        {
+            stream << R"({"data":"A","children":[{"data":"B")";
+            REQUIRE_FALSE(TreeUtilities::ReadJson<std::string>(stream).has_value());
+        }
+
+        SECTION("Missing Data")
+        {
+            stream << R"({"children":[]})";
+            REQUIRE_FALSE(TreeUtilities::ReadJson<std::string>(stream).has_value());
+        }
+
+        SECTION("Mismatched Data Type")
+        {
+            stream << R"({"data":1.5})";
+            REQUIRE_FALSE(TreeUtilities::ReadJson<int>(stream).has_value());
+        }
+
+        SECTION("Trailing Garbage")
+        {
+            stream << R"({"data":1} x)";
+            REQUIRE_FALSE(TreeUtilities::ReadJson<int>(stream).has_value());
+        }
+
+        SECTION("Empty Input")
+        {
+            REQUIRE_FALSE(TreeUtilities::ReadJson<int>(stream, layout).has_value());
+        }
+
+        SECTION("Unknown Parent")
+        {
+            stream << "{\"id\":0,\"parent\":null,\"data\":1}\n"
+                      "{\"id\":1,\"parent\":7,\"data\":2}\n";
+
+            REQUIRE_FALSE(TreeUtilities::ReadJson<int>(stream, layout).has_value());
+        }
+
+        SECTION("Multiple Roots")
+        {
+            stream << "{\"id\":0,\"parent\":null,\"data\":1}\n"
+                      "{\"id\":1,\"parent\":null,\"data\":2}\n";
+
+            REQUIRE_FALSE(TreeUtilities::ReadJson<int>(stream, layout).has_value());
+        }
+    }
+}
+
+TEST_CASE("Mutation Journal")
+{
+    Tree<std::string> tree{ "F" };
+    tree.GetRoot()->AppendChild("B")->AppendChild("A");
+    tree.GetRoot()->GetFirstChild()->AppendChild("D")->AppendChild("C");
+    tree.GetRoot()->GetFirstChild()->GetLastChild()->AppendChild("E");
+    tree.GetRoot()->AppendChild("G")->AppendChild("I")->AppendChild("H");
+
+    const auto collectPreOrder = [](const Tree<std::string>& source) {
+        std::vector<std::string> actual;
+        std::transform(
+            source.beginPreOrder(), source.endPreOrder(), std::back_inserter(actual),
+            [](const auto& node) noexcept { return node.GetData(); });
+
+        return actual;
+    };
+
+    std::stringstream snapshot{ std::ios::in | std::ios::out | std::ios::binary };
+    REQUIRE(TreeUtilities::Save(tree, snapshot));
+
+    std::stringstream journalStream{ std::ios::in | std::ios::out | std::ios::binary };
+
+    {
+        TreeUtilities::Journal<std::string> journal{ tree, journalStream };
+
+        auto* const b = tree.GetRoot()->GetFirstChild();
+        auto* const d = b->GetLastChild();
+
+        journal.AppendChild(*d, "X");
+        journal.PrependChild(*tree.GetRoot(), "Y");
+        journal.SetData(*d->GetFirstChild(), "C2");
+        journal.DeleteFromTree(*b->GetFirstChild());
+        journal.AppendChild(*b, "Z");
+        journal.SortChildren(*d, [](const auto& lhs, const auto& rhs) {
+            return lhs.GetData() > rhs.GetData();
+        });
+
+        REQUIRE(journal.GetRecordCount() == 6);
+        REQUIRE(journal.Flush());
+    }
+
+    const std::vector<std::string> expected = { "F", "Y", "B", "D", "X", "E",
+                                                "C2", "Z", "G", "I", "H" };
+
+    VerifyTraversal(expected, collectPreOrder(tree));
+
+    SECTION("Replaying a Journal onto a Snapshot")
+    {
+        auto replayed = TreeUtilities::Load<std::string>(snapshot);
+        REQUIRE(replayed.has_value());
+        REQUIRE(TreeUtilities::ReplayJournal(*replayed, journalStream));
+
+        VerifyTraversal(expected, collectPreOrder(*replayed));
+    }
+
+    SECTION("Compacting a Journal into a New Snapshot")
+    {
+        std::stringstream compacted{ std::ios::in | std::ios::out | std::ios::binary };
+        REQUIRE(TreeUtilities::CompactJournal<std::string>(snapshot, journalStream, compacted));
+
+        const auto loaded = TreeUtilities::Load<std::string>(compacted);
+        REQUIRE(loaded.has_value());
+
+        VerifyTraversal(expected, collectPreOrder(*loaded));
+    }
+
+    SECTION("Rejecting a Truncated Journal")
+    {
+        auto records = journalStream.str();
+        records.pop_back();
+
+        std::stringstream truncated{ records, std::ios::in | std::ios::binary };
+
+        auto replayed = TreeUtilities::Load<std::string>(snapshot);
+        REQUIRE(replayed.has_value());
+        REQUIRE_FALSE(TreeUtilities::ReplayJournal(*replayed, truncated));
+    }
+
+    SECTION("Rejecting a Journal That Doesn't Match the Tree")
+    {
+        Tree<std::string> unrelated{ "Q" };
+        REQUIRE_FALSE(TreeUtilities::ReplayJournal(unrelated, journalStream));
+    }
+
+    SECTION("Rejecting an Invalid Permutation Without Reordering")
+    {
+        // The journal ends with the permutation recorded by the sort. Repeating the second to last
+        // index in the last position turns it into an invalid one:
+        auto records = journalStream.str();
+        records.back() = records[records.size() - 2];
+
+        std::stringstream corrupted{ records, std::ios::in | std::ios::binary };
+
+        auto replayed = TreeUtilities::Load<std::string>(snapshot);
+        REQUIRE(replayed.has_value());
+        REQUIRE_FALSE(TreeUtilities::ReplayJournal(*replayed, corrupted));
+
+        const std::vector<std::string> unsorted = { "F", "Y", "B", "D", "C2", "E",
+                                                    "X", "Z", "G", "I", "H" };
+
+        VerifyTraversal(unsorted, collectPreOrder(*replayed));
+    }
+
+    SECTION("Journaling Many Mutations of a Wide Node")
+    {
+        Tree<std::string> wideTree{ "Root" };
+        for (int index = 0; index < 1'000; ++index) {
+            wideTree.GetRoot()->AppendChild("Child " + std::to_string(index));
+        }
+
+        std::stringstream wideSnapshot{ std::ios::in | std::ios::out | std::ios::binary };
+        REQUIRE(TreeUtilities::Save(wideTree, wideSnapshot));
+
+        std::stringstream wideJournal{ std::ios::in | std::ios::out | std::ios::binary };
+
+        {
+            TreeUtilities::Journal<std::string> journal{ wideTree, wideJournal };
+
+            auto* const root = wideTree.GetRoot();
+            for (int index = 0; index < 100; ++index) {
+                const auto suffix = std::to_string(index);
+
+                auto* const appended = journal.AppendChild(*root, "Appended " + suffix);
+                journal.AppendChild(*appended, "Grandchild");
+                journal.PrependChild(*root, "Prepended " + suffix);
+            }
+
+            journal.DeleteFromTree(*root->GetFirstChild());
+            journal.DeleteFromTree(*root->GetLastChild());
+            journal.DeleteFromTree(*root->GetFirstChild()->GetNextSibling()->GetNextSibling());
+
+            for (auto* child = root->GetFirstChild(); child; child = child->GetNextSibling()) {
+                journal.SetData(*child, child->GetData() + "!");
+            }
+
+            journal.SortChildren(*root, [](const auto& lhs, const auto& rhs) {
+                return lhs.GetData() < rhs.GetData();
+            });
+
+            journal.AppendChild(*root->GetLastChild(), "Last");
+            REQUIRE(journal.Flush());
+        }
+
+        auto replayed = TreeUtilities::Load<std::string>(wideSnapshot);
+        REQUIRE(replayed.has_value());
+        REQUIRE(TreeUtilities::ReplayJournal(*replayed, wideJournal));
+
+        VerifyTraversal(collectPreOrder(wideTree), collectPreOrder(*replayed));
+    }
+
+    SECTION("Rejecting Input That Isn't a Journal")
+    {
+        auto replayed = TreeUtilities::Load<std::string>(snapshot);
+        REQUIRE(replayed.has_value());
+
+        // A snapshot has a different header:
+        snapshot.clear();
+        snapshot.seekg(0);
+        REQUIRE_FALSE(TreeUtilities::ReplayJournal(*replayed, snapshot));
+    }
+}
+
+TEST_CASE("Copying Trees of FileInfo")
+{
+    Tree<FileInfo> tree{ MakeDirectoryInfo("root", 30) };
+    auto* const directory = tree.GetRoot()->AppendChild(MakeDirectoryInfo("directory", 20));
+    directory->AppendChild(MakeRegularFileInfo("large.txt", 20));
+    tree.GetRoot()->AppendChild(MakeRegularFileInfo("small.txt", 10));
+
+    (*directory)->EditDirectoryDetails().fileCount = 1;
+    (*tree.GetRoot())->EditDirectoryDetails().fileCount = 2;
+
+    SECTION("Copying the Entire Tree")
+    {
+        const Tree<FileInfo> copy{ tree };
+        REQUIRE(copy.Size() == tree.Size());
+
+        const auto* const copiedDirectory = copy.GetRoot()->GetFirstChild();
+        REQUIRE((*copiedDirectory)->name == "directory");
+        REQUIRE((*copiedDirectory)->GetDirectoryDetails().fileCount == 1);
+
+        // The copy owns its own details:
+        (*directory)->EditDirectoryDetails().fileCount = 5;
+        REQUIRE((*copiedDirectory)->GetDirectoryDetails().fileCount == 1);
+    }
+
+    SECTION("Copying Only Large Files")
+    {
+        const auto copy = TreeUtilities::CopyIf(tree, [](const Tree<FileInfo>::Node& node) {
+            return node->type == FileType::Regular && node->size >= 20;
+        });
+
+        std::vector<std::string> actual;
+        std::transform(
+            copy.beginPreOrder(), copy.endPreOrder(), std::back_inserter(actual),
+            [](const auto& node) { return node->name + std::string{ node->GetExtension() }; });
+
+        const std::vector<std::string> expected = { "root", "directory", "large.txt" };
+        VerifyTraversal(expected, actual);
+
+        REQUIRE((*copy.GetRoot())->GetDirectoryDetails().fileCount == 2);
+    }
+}